@@ -21,11 +21,22 @@
  * by Sean Barrett - http://nothings.org/
  *
  * @Daniel Starke (2023-05-11): fixed C99 related warnings issued by GCC with pedantic flag
+ * @Daniel Starke (2026-10-18): added nsvgSetPathDecoder()
+ * @Daniel Starke (2026-10-18): added band rendering and culling of edges outside the rows
+ * @Daniel Starke (2026-10-18): added nsvgRasterizeBandMask()
+ * @Daniel Starke (2026-10-18): added SSE2 span filling and mask compositing
+ * @Daniel Starke (2026-10-18): replaced the pooled active edge list by a sorted array of active edges
+ * @Daniel Starke (2026-10-18): round caps and joins use a precomputed half circle template
+ * @Daniel Starke (2026-10-18): added nsvgSetCoverageKernels()
+ * @Daniel Starke (2026-10-18): added nsvgPrepareBands() to flatten and sort the edges once for all bands
+ * @Daniel Starke (2026-10-18): removed the unused link of NSVGedge
+ * @Daniel Starke (2026-10-18): coverage kernels use size_t counts, SSE2 versions are left to nsvgSetCoverageKernels()
  */
 
 #ifndef NANOSVGRAST_H
 #define NANOSVGRAST_H
 
+#include <stddef.h>
 #include "nanosvg.h"
 
 #ifndef NANOSVGRAST_CPLUSPLUS
@@ -65,9 +76,61 @@ void nsvgRasterize(NSVGrasterizer* r,
 				   NSVGimage* image, float tx, float ty, float scale,
 				   unsigned char* dst, int w, int h, int stride);
 
+// Rasterizes a band of rows of the SVG image, returns 8-bit coverage mask
+// Only the rows y0 to y0+rows-1 of the w x h image are rendered into dst, which
+// holds these rows only. This allows to render large images band by band.
+// Only the coverage is written with one byte per pixel. The colour of each
+// paint is ignored and gradient paints are treated as opaque. This is
+// sufficient if all shapes use the same colour, which can be applied to the
+// mask afterwards. The stride is given in bytes and needs to be at least w.
+// The other parameters are the same as for nsvgRasterize().
+void nsvgRasterizeBandMask(NSVGrasterizer* r,
+						   NSVGimage* image, float tx, float ty, float scale,
+						   unsigned char* dst, int w, int y0, int rows, int stride);
+
+// Prepares the SVG image for rendering band by band
+// All paths are flattened and expanded once and their edges are sorted by y
+// into buckets of bandRows rows of the w x h image. The prepared band
+// function below then only processes the edges crossing the requested rows.
+// The image is not accessed afterwards. Returns 1 on success or 0 on
+// allocation failure. The other parameters are the same as for nsvgRasterize().
+int nsvgPrepareBands(NSVGrasterizer* r,
+					 NSVGimage* image, float tx, float ty, float scale,
+					 int w, int h, int bandRows);
+
+// Rasterizes a band of rows of the image passed to nsvgPrepareBands(), returns 8-bit coverage mask
+// Only the rows y0 to y0+rows-1 are rendered into dst, which holds these rows
+// only, with one byte per pixel like in nsvgRasterizeBandMask(). The stride is
+// given in bytes and needs to be at least the width passed to nsvgPrepareBands().
+void nsvgRasterizePreparedBandMask(NSVGrasterizer* r,
+								   unsigned char* dst, int y0, int rows, int stride);
+
 // Deletes rasterizer context.
 void nsvgDeleteRasterizer(NSVGrasterizer*);
 
+// Returns the points of the given path in the same layout as path->pts.
+// The returned points need to stay valid until the next call.
+typedef const float* (*NSVGpathDecoder)(void* userData, const NSVGpath* path);
+
+// Sets a callback which provides the points of each path while rasterizing.
+// This allows the caller to keep the path points in a compact encoding which
+// is only decoded on demand. Pass NULL to use path->pts directly (default).
+void nsvgSetPathDecoder(NSVGrasterizer* r, NSVGpathDecoder decoder, void* userData);
+
+// Adds weight to count coverage values (wrapping around like byte arithmetic).
+typedef void (*NSVGfillRun)(unsigned char* cover, size_t count, unsigned int weight);
+
+// Blends count coverage values with alpha over the 8-bit mask dst:
+// a = cover * alpha / 255; dst = a + (255 - a) * dst / 255
+// Both divisions are computed as ((x + 1) * 257) >> 16.
+typedef void (*NSVGblendMask)(unsigned char* dst, const unsigned char* cover, size_t count, unsigned int alpha);
+
+// Replaces the inner loops of the coverage computation and mask rasterization,
+// e.g. by implementations for the instruction set of the current CPU. The
+// results need to be identical to the built-in ones. Pass NULL to use the
+// built-in implementation (default).
+void nsvgSetCoverageKernels(NSVGrasterizer* r, NSVGfillRun fillRun, NSVGblendMask blendMask);
+
 
 #ifndef NANOSVGRAST_CPLUSPLUS
 #ifdef __cplusplus
@@ -85,12 +148,10 @@ void nsvgDeleteRasterizer(NSVGrasterizer*);
 #define NSVG__FIXSHIFT		10
 #define NSVG__FIX			(1 << NSVG__FIXSHIFT)
 #define NSVG__FIXMASK		(NSVG__FIX-1)
-#define NSVG__MEMPAGE_SIZE	1024
 
 typedef struct NSVGedge {
 	float x0,y0, x1,y1;
 	int dir;
-	struct NSVGedge* next;
 } NSVGedge;
 
 typedef struct NSVGpoint {
@@ -101,18 +162,15 @@ typedef struct NSVGpoint {
 	unsigned char flags;
 } NSVGpoint;
 
-typedef struct NSVGactiveEdge {
-	int x,dx;
-	float ey;
-	int dir;
-	struct NSVGactiveEdge *next;
-} NSVGactiveEdge;
-
-typedef struct NSVGmemPage {
-	unsigned char mem[NSVG__MEMPAGE_SIZE];
-	int size;
-	struct NSVGmemPage* next;
-} NSVGmemPage;
+// Active edges sorted by x, stored as separate arrays to step all edges at once
+typedef struct NSVGactiveEdges {
+	int* x;
+	int* dx;
+	float* ey;
+	int* dir;
+	int n;
+	int capacity;
+} NSVGactiveEdges;
 
 typedef struct NSVGcachedPaint {
 	signed char type;
@@ -121,6 +179,12 @@ typedef struct NSVGcachedPaint {
 	unsigned int colors[256];
 } NSVGcachedPaint;
 
+// Fill or stroke of a shape prepared by nsvgPrepareBands()
+typedef struct NSVGbandLayer {
+	NSVGcachedPaint cache;
+	char fillRule;
+} NSVGbandLayer;
+
 struct NSVGrasterizer
 {
 	float px, py;
@@ -140,17 +204,49 @@ struct NSVGrasterizer
 	int npoints2;
 	int cpoints2;
 
-	NSVGactiveEdge* freelist;
-	NSVGmemPage* pages;
-	NSVGmemPage* curpage;
+	NSVGactiveEdges active;
+
+	float* arc;
+	int narc;
+	int carc;
+	float arcWidth;
 
 	unsigned char* scanline;
 	int cscanline;
 
 	unsigned char* bitmap;
 	int width, height, stride;
+	int y0;
+	int mask;
+
+	NSVGpathDecoder decoder;
+	void* decoderData;
+
+	NSVGfillRun fillRun;
+	NSVGblendMask blendMask;
+
+	// Edges prepared by nsvgPrepareBands(), sorted by y0 per layer. Each
+	// layer holds the first edge and the first spill index of each bucket.
+	// The spill list holds the edges which continue into a bucket from an
+	// earlier one.
+	NSVGedge* bandEdges;
+	int nbandEdges;
+	int cbandEdges;
+	int* bandSpill;
+	int nbandSpill;
+	int cbandSpill;
+	int* bandOffsets;
+	int cbandOffsets;
+	NSVGbandLayer* bandLayers;
+	int nbandLayers;
+	int cbandLayers;
+	int bandRows, nbuckets, bandWidth;
+	float bandTx, bandTy, bandScale;
 };
 
+static void nsvg__fillRun(unsigned char* cover, size_t count, unsigned int weight);
+static void nsvg__blendMask(unsigned char* dst, const unsigned char* cover, size_t count, unsigned int alpha);
+
 NSVGrasterizer* nsvgCreateRasterizer(void)
 {
 	NSVGrasterizer* r = (NSVGrasterizer*)malloc(sizeof(NSVGrasterizer));
@@ -160,6 +256,9 @@ NSVGrasterizer* nsvgCreateRasterizer(void)
 	r->tessTol = 0.25f;
 	r->distTol = 0.01f;
 
+	r->fillRun = nsvg__fillRun;
+	r->blendMask = nsvg__blendMask;
+
 	return r;
 
 error:
@@ -167,70 +266,44 @@ error:
 	return NULL;
 }
 
-void nsvgDeleteRasterizer(NSVGrasterizer* r)
+void nsvgSetPathDecoder(NSVGrasterizer* r, NSVGpathDecoder decoder, void* userData)
 {
-	NSVGmemPage* p;
-
-	if (r == NULL) return;
-
-	p = r->pages;
-	while (p != NULL) {
-		NSVGmemPage* next = p->next;
-		free(p);
-		p = next;
-	}
-
-	if (r->edges) free(r->edges);
-	if (r->points) free(r->points);
-	if (r->points2) free(r->points2);
-	if (r->scanline) free(r->scanline);
-
-	free(r);
+	r->decoder = decoder;
+	r->decoderData = userData;
 }
 
-static NSVGmemPage* nsvg__nextPage(NSVGrasterizer* r, NSVGmemPage* cur)
+void nsvgSetCoverageKernels(NSVGrasterizer* r, NSVGfillRun fillRun, NSVGblendMask blendMask)
 {
-	NSVGmemPage *newp;
-
-	// If using existing chain, return the next page in chain
-	if (cur != NULL && cur->next != NULL) {
-		return cur->next;
-	}
-
-	// Alloc new page
-	newp = (NSVGmemPage*)malloc(sizeof(NSVGmemPage));
-	if (newp == NULL) return NULL;
-	memset(newp, 0, sizeof(NSVGmemPage));
-
-	// Add to linked list
-	if (cur != NULL)
-		cur->next = newp;
-	else
-		r->pages = newp;
-
-	return newp;
+	r->fillRun = (fillRun != NULL) ? fillRun : nsvg__fillRun;
+	r->blendMask = (blendMask != NULL) ? blendMask : nsvg__blendMask;
 }
 
-static void nsvg__resetPool(NSVGrasterizer* r)
+static const float* nsvg__pathPoints(NSVGrasterizer* r, const NSVGpath* path)
 {
-	NSVGmemPage* p = r->pages;
-	while (p != NULL) {
-		p->size = 0;
-		p = p->next;
-	}
-	r->curpage = r->pages;
+	if (r->decoder != NULL)
+		return r->decoder(r->decoderData, path);
+	return path->pts;
 }
 
-static unsigned char* nsvg__alloc(NSVGrasterizer* r, int size)
+void nsvgDeleteRasterizer(NSVGrasterizer* r)
 {
-	unsigned char* buf;
-	if (size > NSVG__MEMPAGE_SIZE) return NULL;
-	if (r->curpage == NULL || r->curpage->size+size > NSVG__MEMPAGE_SIZE) {
-		r->curpage = nsvg__nextPage(r, r->curpage);
-	}
-	buf = &r->curpage->mem[r->curpage->size];
-	r->curpage->size += size;
-	return buf;
+	if (r == NULL) return;
+
+	if (r->active.x) free(r->active.x);
+	if (r->active.dx) free(r->active.dx);
+	if (r->active.ey) free(r->active.ey);
+	if (r->active.dir) free(r->active.dir);
+	if (r->edges) free(r->edges);
+	if (r->points) free(r->points);
+	if (r->points2) free(r->points2);
+	if (r->arc) free(r->arc);
+	if (r->scanline) free(r->scanline);
+	if (r->bandEdges) free(r->bandEdges);
+	if (r->bandSpill) free(r->bandSpill);
+	if (r->bandOffsets) free(r->bandOffsets);
+	if (r->bandLayers) free(r->bandLayers);
+
+	free(r);
 }
 
 static int nsvg__ptEquals(float x1, float y1, float x2, float y2, float tol)
@@ -375,17 +448,21 @@ static void nsvg__flattenShape(NSVGrasterizer* r, NSVGshape* shape, float scale)
 {
 	int i, j;
 	NSVGpath* path;
+	const float* pts;
 
 	for (path = shape->paths; path != NULL; path = path->next) {
 		r->npoints = 0;
+		pts = nsvg__pathPoints(r, path);
+		if (pts == NULL)
+			continue;
 		// Flatten path
-		nsvg__addPathPoint(r, path->pts[0]*scale, path->pts[1]*scale, 0);
+		nsvg__addPathPoint(r, pts[0]*scale, pts[1]*scale, 0);
 		for (i = 0; i < path->npts-1; i += 3) {
-			float* p = &path->pts[i*2];
+			const float* p = &pts[i*2];
 			nsvg__flattenCubicBez(r, p[0]*scale,p[1]*scale, p[2]*scale,p[3]*scale, p[4]*scale,p[5]*scale, p[6]*scale,p[7]*scale, 0, 0);
 		}
 		// Close path
-		nsvg__addPathPoint(r, path->pts[0]*scale, path->pts[1]*scale, 0);
+		nsvg__addPathPoint(r, pts[0]*scale, pts[1]*scale, 0);
 		// Build edges
 		for (i = 0, j = r->npoints-1; i < r->npoints; j = i++)
 			nsvg__addEdge(r, r->points[j].x, r->points[j].y, r->points[i].x, r->points[i].y);
@@ -462,8 +539,7 @@ static void nsvg__roundCap(NSVGrasterizer* r, NSVGpoint* left, NSVGpoint* right,
 	float lx = 0, ly = 0, rx = 0, ry = 0, prevx = 0, prevy = 0;
 
 	for (i = 0; i < ncap; i++) {
-		float a = (float)i/(float)(ncap-1)*NSVG_PI;
-		float ax = cosf(a) * w, ay = sinf(a) * w;
+		float ax = r->arc[i*2] * w, ay = r->arc[i*2+1] * w;
 		float x = px - dlx*ax - dx*ay;
 		float y = py - dly*ax - dy*ay;
 
@@ -551,27 +627,32 @@ static void nsvg__roundJoin(NSVGrasterizer* r, NSVGpoint* left, NSVGpoint* right
 	float w = lineWidth * 0.5f;
 	float dlx0 = p0->dy, dly0 = -p0->dx;
 	float dlx1 = p1->dy, dly1 = -p1->dx;
-	float a0 = atan2f(dly0, dlx0);
-	float a1 = atan2f(dly1, dlx1);
-	float da = a1 - a0;
+	// cosine and direction of the angle between both segments
+	float cosda = dlx0*dlx1 + dly0*dly1;
+	float sign = (dlx0*dly1 - dly0*dlx1) < 0.0f ? -1.0f : 1.0f;
 	float lx, ly, rx, ry;
 
-	if (da < NSVG_PI) da += NSVG_PI*2;
-	if (da > NSVG_PI) da -= NSVG_PI*2;
-
-	n = (int)ceilf((nsvg__absf(da) / NSVG_PI) * (float)ncap);
-	if (n < 2) n = 2;
-	if (n > ncap) n = ncap;
+	// rotate by the template angles which are smaller than the join angle,
+	// the end direction is added as last point
+	n = 1;
+	while (n < ncap-1 && r->arc[n*2] > cosda)
+		n++;
 
 	lx = left->x;
 	ly = left->y;
 	rx = right->x;
 	ry = right->y;
 
-	for (i = 0; i < n; i++) {
-		float u = (float)i/(float)(n-1);
-		float a = a0 + u*da;
-		float ax = cosf(a) * w, ay = sinf(a) * w;
+	for (i = 0; i <= n; i++) {
+		float ax, ay;
+		if (i < n) {
+			float c = r->arc[i*2], s = sign * r->arc[i*2+1];
+			ax = (c*dlx0 - s*dly0) * w;
+			ay = (s*dlx0 + c*dly0) * w;
+		} else {
+			ax = dlx1 * w;
+			ay = dly1 * w;
+		}
 		float lx1 = p1->x - ax, ly1 = p1->y - ay;
 		float rx1 = p1->x + ax, ry1 = p1->y + ay;
 
@@ -607,13 +688,43 @@ static int nsvg__curveDivs(float r, float arc, float tol)
 	return divs;
 }
 
+// Returns the divisions per half circle for the given line width and prepares
+// the matching unit half circle template (cos/sin pairs) for round caps and joins.
+// The template is kept as long as the line width does not change.
+static int nsvg__roundTemplate(NSVGrasterizer* r, float lineWidth)
+{
+	int i, ncap;
+
+	if (r->narc > 0 && r->arcWidth == lineWidth)
+		return r->narc;
+
+	ncap = nsvg__curveDivs(lineWidth*0.5f, NSVG_PI, r->tessTol);
+	if (ncap > r->carc) {
+		float* arc = (float*)realloc(r->arc, sizeof(float) * 2 * ncap);
+		if (arc == NULL) return 0;
+		r->arc = arc;
+		r->carc = ncap;
+	}
+	for (i = 0; i < ncap; i++) {
+		float a = (float)i/(float)(ncap-1)*NSVG_PI;
+		r->arc[i*2] = cosf(a);
+		r->arc[i*2+1] = sinf(a);
+	}
+	r->narc = ncap;
+	r->arcWidth = lineWidth;
+
+	return ncap;
+}
+
 static void nsvg__expandStroke(NSVGrasterizer* r, NSVGpoint* points, int npoints, int closed, int lineJoin, int lineCap, float lineWidth)
 {
-	int ncap = nsvg__curveDivs(lineWidth*0.5f, NSVG_PI, r->tessTol);	// Calculate divisions per half circle.
+	int ncap = nsvg__roundTemplate(r, lineWidth);	// Calculate divisions per half circle.
 	NSVGpoint left = {0,0,0,0,0,0,0,0}, right = {0,0,0,0,0,0,0,0}, firstLeft = {0,0,0,0,0,0,0,0}, firstRight = {0,0,0,0,0,0,0,0};
 	NSVGpoint* p0, *p1;
 	int j, s, e;
 
+	if (ncap == 0) return;
+
 	// Build stroke edges
 	if (closed) {
 		// Looping
@@ -744,13 +855,17 @@ static void nsvg__flattenShapeStroke(NSVGrasterizer* r, NSVGshape* shape, float
 	int lineJoin = shape->strokeLineJoin;
 	int lineCap = shape->strokeLineCap;
 	float lineWidth = shape->strokeWidth * scale;
+	const float* pts;
 
 	for (path = shape->paths; path != NULL; path = path->next) {
 		// Flatten path
 		r->npoints = 0;
-		nsvg__addPathPoint(r, path->pts[0]*scale, path->pts[1]*scale, NSVG_PT_CORNER);
+		pts = nsvg__pathPoints(r, path);
+		if (pts == NULL)
+			continue;
+		nsvg__addPathPoint(r, pts[0]*scale, pts[1]*scale, NSVG_PT_CORNER);
 		for (i = 0; i < path->npts-1; i += 3) {
-			float* p = &path->pts[i*2];
+			const float* p = &pts[i*2];
 			nsvg__flattenCubicBez(r, p[0]*scale,p[1]*scale, p[2]*scale,p[3]*scale, p[4]*scale,p[5]*scale, p[6]*scale,p[7]*scale, 0, NSVG_PT_CORNER);
 		}
 		if (r->npoints < 2)
@@ -855,43 +970,111 @@ static int nsvg__cmpEdge(const void *p, const void *q)
 }
 
 
-static NSVGactiveEdge* nsvg__addActive(NSVGrasterizer* r, NSVGedge* e, float startPoint)
+static int nsvg__growActive(NSVGactiveEdges* a)
 {
-	 NSVGactiveEdge* z;
+	int capacity = a->capacity > 0 ? a->capacity * 2 : 64;
+	int* x = (int*)realloc(a->x, sizeof(int) * capacity);
+	if (x == NULL) return 0;
+	a->x = x;
+	x = (int*)realloc(a->dx, sizeof(int) * capacity);
+	if (x == NULL) return 0;
+	a->dx = x;
+	x = (int*)realloc(a->dir, sizeof(int) * capacity);
+	if (x == NULL) return 0;
+	a->dir = x;
+	float* ey = (float*)realloc(a->ey, sizeof(float) * capacity);
+	if (ey == NULL) return 0;
+	a->ey = ey;
+	a->capacity = capacity;
+	return 1;
+}
 
-	if (r->freelist != NULL) {
-		// Restore from freelist.
-		z = r->freelist;
-		r->freelist = z->next;
-	} else {
-		// Alloc new edge.
-		z = (NSVGactiveEdge*)nsvg__alloc(r, sizeof(NSVGactiveEdge));
-		if (z == NULL) return NULL;
-	}
+static int nsvg__addActive(NSVGactiveEdges* a, NSVGedge* e, float startPoint)
+{
+	int i, x, dx;
+
+	if (a->n + 1 > a->capacity && !nsvg__growActive(a)) return 0;
 
 	float dxdy = (e->x1 - e->x0) / (e->y1 - e->y0);
 //	STBTT_assert(e->y0 <= start_point);
 	// round dx down to avoid going too far
 	if (dxdy < 0)
-		z->dx = (int)(-floorf(NSVG__FIX * -dxdy));
+		dx = (int)(-floorf(NSVG__FIX * -dxdy));
 	else
-		z->dx = (int)floorf(NSVG__FIX * dxdy);
-	z->x = (int)floorf(NSVG__FIX * (e->x0 + dxdy * (startPoint - e->y0)));
-//	z->x -= off_x * FIX;
-	z->ey = e->y1;
-	z->next = 0;
-	z->dir = e->dir;
-
-	return z;
+		dx = (int)floorf(NSVG__FIX * dxdy);
+	x = (int)floorf(NSVG__FIX * (e->x0 + dxdy * (startPoint - e->y0)));
+//	x -= off_x * FIX;
+
+	// find insertion point: in front of the first edge at x or right,
+	// but never in front of the first edge if it is exactly at x
+	for (i = a->n; i > 0 && (a->x[i-1] > x || (a->x[i-1] == x && i > 1)); i--) {
+		a->x[i] = a->x[i-1];
+		a->dx[i] = a->dx[i-1];
+		a->ey[i] = a->ey[i-1];
+		a->dir[i] = a->dir[i-1];
+	}
+	a->x[i] = x;
+	a->dx[i] = dx;
+	a->ey[i] = e->y1;
+	a->dir[i] = e->dir;
+	a->n++;
+
+	return 1;
+}
+
+// Removes all edges which terminate before the given scanline and advances the others
+static void nsvg__stepActive(NSVGactiveEdges* a, float scany)
+{
+	int i, n = 0;
+
+	for (i = 0; i < a->n; i++)
+		a->x[i] += a->dx[i];
+
+	for (i = 0; i < a->n; i++) {
+		if (a->ey[i] > scany) {
+			a->x[n] = a->x[i];
+			a->dx[n] = a->dx[i];
+			a->ey[n] = a->ey[i];
+			a->dir[n] = a->dir[i];
+			n++;
+		}
+	}
+	a->n = n;
+}
+
+// Restores the x order after stepping with a stable insertion sort
+static void nsvg__sortActive(NSVGactiveEdges* a)
+{
+	int i, j;
+
+	for (i = 1; i < a->n; i++) {
+		int x = a->x[i];
+		if (a->x[i-1] <= x) continue;
+		int dx = a->dx[i];
+		float ey = a->ey[i];
+		int dir = a->dir[i];
+		for (j = i; j > 0 && a->x[j-1] > x; j--) {
+			a->x[j] = a->x[j-1];
+			a->dx[j] = a->dx[j-1];
+			a->ey[j] = a->ey[j-1];
+			a->dir[j] = a->dir[j-1];
+		}
+		a->x[j] = x;
+		a->dx[j] = dx;
+		a->ey[j] = ey;
+		a->dir[j] = dir;
+	}
 }
 
-static void nsvg__freeActive(NSVGrasterizer* r, NSVGactiveEdge* z)
+// Adds the weight to count coverage values (wraps around like the byte arithmetic)
+static void nsvg__fillRun(unsigned char* cover, size_t count, unsigned int weight)
 {
-	z->next = r->freelist;
-	r->freelist = z;
+	size_t i;
+	for (i = 0; i < count; i++)
+		cover[i] = (unsigned char)(cover[i] + weight);
 }
 
-static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax)
+static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax, NSVGfillRun fillRun)
 {
 	int i = x0 >> NSVG__FIXSHIFT;
 	int j = x1 >> NSVG__FIXSHIFT;
@@ -912,8 +1095,8 @@ static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1,
 			else
 				j = len; // clip
 
-			for (++i; i < j; ++i) // fill pixels between x0 and x1
-				scanline[i] = (unsigned char)(scanline[i] + maxWeight);
+			if (++i < j) // fill pixels between x0 and x1
+				fillRun(&scanline[i], (size_t)(j - i), (unsigned int)maxWeight);
 		}
 	}
 }
@@ -921,36 +1104,34 @@ static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1,
 // note: this routine clips fills that extend off the edges... ideally this
 // wouldn't happen, but it could happen if the truetype glyph bounding boxes
 // are wrong, or if the user supplies a too-small bitmap
-static void nsvg__fillActiveEdges(unsigned char* scanline, int len, NSVGactiveEdge* e, int maxWeight, int* xmin, int* xmax, char fillRule)
+static void nsvg__fillActiveEdges(unsigned char* scanline, int len, const NSVGactiveEdges* a, int maxWeight, int* xmin, int* xmax, char fillRule, NSVGfillRun fillRun)
 {
 	// non-zero winding fill
-	int x0 = 0, w = 0;
+	int x0 = 0, w = 0, i;
 
 	if (fillRule == NSVG_FILLRULE_NONZERO) {
 		// Non-zero
-		while (e != NULL) {
+		for (i = 0; i < a->n; i++) {
 			if (w == 0) {
 				// if we're currently at zero, we need to record the edge start point
-				x0 = e->x; w += e->dir;
+				x0 = a->x[i]; w += a->dir[i];
 			} else {
-				int x1 = e->x; w += e->dir;
+				int x1 = a->x[i]; w += a->dir[i];
 				// if we went to zero, we need to draw
 				if (w == 0)
-					nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax);
+					nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax, fillRun);
 			}
-			e = e->next;
 		}
 	} else if (fillRule == NSVG_FILLRULE_EVENODD) {
 		// Even-odd
-		while (e != NULL) {
+		for (i = 0; i < a->n; i++) {
 			if (w == 0) {
 				// if we're currently at zero, we need to record the edge start point
-				x0 = e->x; w = 1;
+				x0 = a->x[i]; w = 1;
 			} else {
-				int x1 = e->x; w = 0;
-				nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax);
+				int x1 = a->x[i]; w = 0;
+				nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax, fillRun);
 			}
-			e = e->next;
 		}
 	}
 }
@@ -1115,89 +1296,63 @@ static void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* co
 	}
 }
 
+static void nsvg__blendMask(unsigned char* dst, const unsigned char* cover, size_t count, unsigned int alpha)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		int a = nsvg__div255((int)cover[i] * (int)alpha);
+		// Blend over
+		dst[i] = (unsigned char)(a + nsvg__div255((255 - a) * (int)dst[i]));
+	}
+}
+
 static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, float scale, NSVGcachedPaint* cache, char fillRule)
 {
-	NSVGactiveEdge *active = NULL;
+	NSVGactiveEdges* active = &r->active;
 	int y, s;
 	int e = 0;
 	int maxWeight = (255 / NSVG__SUBSAMPLES);  // weight per vertical scanline
 	int xmin, xmax;
+	// the mask only uses the alpha of solid colours, gradients are opaque
+	int maskAlpha = (cache->type == NSVG_PAINT_COLOR) ? (int)((cache->colors[0] >> 24) & 0xff) : 255;
+
+	active->n = 0;
 
-	for (y = 0; y < r->height; y++) {
+	for (y = r->y0; y < r->y0 + r->height; y++) {
 		memset(r->scanline, 0, r->width);
 		xmin = r->width;
 		xmax = 0;
 		for (s = 0; s < NSVG__SUBSAMPLES; ++s) {
 			// find center of pixel for this scanline
 			float scany = (float)(y*NSVG__SUBSAMPLES + s) + 0.5f;
-			NSVGactiveEdge **step = &active;
 
 			// update all active edges;
 			// remove all active edges that terminate before the center of this scanline
-			while (*step) {
-				NSVGactiveEdge *z = *step;
-				if (z->ey <= scany) {
-					*step = z->next; // delete from list
-//					NSVG__assert(z->valid);
-					nsvg__freeActive(r, z);
-				} else {
-					z->x += z->dx; // advance to position for current scanline
-					step = &((*step)->next); // advance through list
-				}
-			}
+			nsvg__stepActive(active, scany);
 
 			// resort the list if needed
-			for (;;) {
-				int changed = 0;
-				step = &active;
-				while (*step && (*step)->next) {
-					if ((*step)->x > (*step)->next->x) {
-						NSVGactiveEdge* t = *step;
-						NSVGactiveEdge* q = t->next;
-						t->next = q->next;
-						q->next = t;
-						*step = q;
-						changed = 1;
-					}
-					step = &(*step)->next;
-				}
-				if (!changed) break;
-			}
+			nsvg__sortActive(active);
 
 			// insert all edges that start before the center of this scanline -- omit ones that also end on this scanline
 			while (e < r->nedges && r->edges[e].y0 <= scany) {
 				if (r->edges[e].y1 > scany) {
-					NSVGactiveEdge* z = nsvg__addActive(r, &r->edges[e], scany);
-					if (z == NULL) break;
-					// find insertion point
-					if (active == NULL) {
-						active = z;
-					} else if (z->x < active->x) {
-						// insert at front
-						z->next = active;
-						active = z;
-					} else {
-						// find thing to insert AFTER
-						NSVGactiveEdge* p = active;
-						while (p->next && p->next->x < z->x)
-							p = p->next;
-						// at this point, p->next->x is NOT < z->x
-						z->next = p->next;
-						p->next = z;
-					}
+					if (!nsvg__addActive(active, &r->edges[e], scany)) break;
 				}
 				e++;
 			}
 
 			// now process all active edges in non-zero fashion
-			if (active != NULL)
-				nsvg__fillActiveEdges(r->scanline, r->width, active, maxWeight, &xmin, &xmax, fillRule);
+			if (active->n != 0)
+				nsvg__fillActiveEdges(r->scanline, r->width, active, maxWeight, &xmin, &xmax, fillRule, r->fillRun);
 		}
 		// Blit
 		if (xmin < 0) xmin = 0;
 		if (xmax > r->width-1) xmax = r->width-1;
-		if (xmin <= xmax) {
-			nsvg__scanlineSolid(&r->bitmap[y * r->stride] + xmin*4, xmax-xmin+1, &r->scanline[xmin], xmin, y, tx,ty, scale, cache);
+		if (xmin <= xmax && r->mask) {
+			r->blendMask(&r->bitmap[(y - r->y0) * r->stride] + xmin, &r->scanline[xmin], (size_t)(xmax-xmin+1), (unsigned int)maskAlpha);
+		} else if (xmin <= xmax) {
+			nsvg__scanlineSolid(&r->bitmap[(y - r->y0) * r->stride] + xmin*4, xmax-xmin+1, &r->scanline[xmin], xmin, y, tx,ty, scale, cache);
 		}
 	}
 
@@ -1365,12 +1520,65 @@ static void dumpEdges(NSVGrasterizer* r, const char* name)
 }
 */
 
-void nsvgRasterize(NSVGrasterizer* r,
-				   NSVGimage* image, float tx, float ty, float scale,
-				   unsigned char* dst, int w, int h, int stride)
+// Removes all edges which do not cross the rows to render.
+static void nsvg__cullEdges(NSVGrasterizer* r)
+{
+	float ymin = (float)(r->y0 * NSVG__SUBSAMPLES);
+	float ymax = (float)((r->y0 + r->height) * NSVG__SUBSAMPLES);
+	int i, n = 0;
+
+	for (i = 0; i < r->nedges; i++) {
+		if (r->edges[i].y1 > ymin && r->edges[i].y0 < ymax)
+			r->edges[n++] = r->edges[i];
+	}
+	r->nedges = n;
+}
+
+// Flattens the fill or stroke of the shape into sorted edges of the rows to render.
+// Returns 0 if the edges could not be allocated.
+static int nsvg__flattenLayer(NSVGrasterizer* r, NSVGshape* shape, int stroke, float tx, float ty, float scale)
 {
-	NSVGshape *shape = NULL;
 	NSVGedge *e = NULL;
+	int i;
+
+	r->nedges = 0;
+
+	if (stroke) {
+		nsvg__flattenShapeStroke(r, shape, scale);
+
+//		dumpEdges(r, "edge.svg");
+	} else {
+		nsvg__flattenShape(r, shape, scale);
+	}
+	if (r->edges == NULL && r->cedges > 0) {
+		// allocation failed
+		r->nedges = 0;
+		r->cedges = 0;
+		return 0;
+	}
+
+	// Scale and translate edges
+	for (i = 0; i < r->nedges; i++) {
+		e = &r->edges[i];
+		e->x0 = tx + e->x0;
+		e->y0 = (ty + e->y0) * NSVG__SUBSAMPLES;
+		e->x1 = tx + e->x1;
+		e->y1 = (ty + e->y1) * NSVG__SUBSAMPLES;
+	}
+	nsvg__cullEdges(r);
+
+	// Rasterize edges
+	if (r->nedges != 0)
+		qsort(r->edges, r->nedges, sizeof(NSVGedge), nsvg__cmpEdge);
+
+	return 1;
+}
+
+static void nsvg__rasterize(NSVGrasterizer* r,
+							NSVGimage* image, float tx, float ty, float scale,
+							unsigned char* dst, int w, int y0, int h, int stride, int mask)
+{
+	NSVGshape *shape = NULL;
 	NSVGcachedPaint cache;
 	int i;
 
@@ -1378,6 +1586,8 @@ void nsvgRasterize(NSVGrasterizer* r,
 	r->width = w;
 	r->height = h;
 	r->stride = stride;
+	r->y0 = y0;
+	r->mask = mask;
 
 	if (w > r->cscanline) {
 		r->cscanline = w;
@@ -1386,31 +1596,14 @@ void nsvgRasterize(NSVGrasterizer* r,
 	}
 
 	for (i = 0; i < h; i++)
-		memset(&dst[i*stride], 0, w*4);
+		memset(&dst[i*stride], 0, mask ? w : w*4);
 
 	for (shape = image->shapes; shape != NULL; shape = shape->next) {
 		if (!(shape->flags & NSVG_FLAGS_VISIBLE))
 			continue;
 
 		if (shape->fill.type != NSVG_PAINT_NONE) {
-			nsvg__resetPool(r);
-			r->freelist = NULL;
-			r->nedges = 0;
-
-			nsvg__flattenShape(r, shape, scale);
-
-			// Scale and translate edges
-			for (i = 0; i < r->nedges; i++) {
-				e = &r->edges[i];
-				e->x0 = tx + e->x0;
-				e->y0 = (ty + e->y0) * NSVG__SUBSAMPLES;
-				e->x1 = tx + e->x1;
-				e->y1 = (ty + e->y1) * NSVG__SUBSAMPLES;
-			}
-
-			// Rasterize edges
-			if (r->nedges != 0)
-				qsort(r->edges, r->nedges, sizeof(NSVGedge), nsvg__cmpEdge);
+			nsvg__flattenLayer(r, shape, 0, tx, ty, scale);
 
 			// now, traverse the scanlines and find the intersections on each scanline, use non-zero rule
 			nsvg__initPaint(&cache, &shape->fill, shape->opacity);
@@ -1418,40 +1611,278 @@ void nsvgRasterize(NSVGrasterizer* r,
 			nsvg__rasterizeSortedEdges(r, tx,ty,scale, &cache, shape->fillRule);
 		}
 		if (shape->stroke.type != NSVG_PAINT_NONE && (shape->strokeWidth * scale) > 0.01f) {
-			nsvg__resetPool(r);
-			r->freelist = NULL;
-			r->nedges = 0;
+			nsvg__flattenLayer(r, shape, 1, tx, ty, scale);
 
-			nsvg__flattenShapeStroke(r, shape, scale);
+			// now, traverse the scanlines and find the intersections on each scanline, use non-zero rule
+			nsvg__initPaint(&cache, &shape->stroke, shape->opacity);
 
-//			dumpEdges(r, "edge.svg");
+			nsvg__rasterizeSortedEdges(r, tx,ty,scale, &cache, NSVG_FILLRULE_NONZERO);
+		}
+	}
 
-			// Scale and translate edges
-			for (i = 0; i < r->nedges; i++) {
-				e = &r->edges[i];
-				e->x0 = tx + e->x0;
-				e->y0 = (ty + e->y0) * NSVG__SUBSAMPLES;
-				e->x1 = tx + e->x1;
-				e->y1 = (ty + e->y1) * NSVG__SUBSAMPLES;
-			}
+	if (!mask)
+		nsvg__unpremultiplyAlpha(dst, w, h, stride);
+
+	r->bitmap = NULL;
+	r->width = 0;
+	r->height = 0;
+	r->stride = 0;
+	r->y0 = 0;
+	r->mask = 0;
+}
 
-			// Rasterize edges
-			if (r->nedges != 0)
-				qsort(r->edges, r->nedges, sizeof(NSVGedge), nsvg__cmpEdge);
+void nsvgRasterize(NSVGrasterizer* r,
+				   NSVGimage* image, float tx, float ty, float scale,
+				   unsigned char* dst, int w, int h, int stride)
+{
+	nsvg__rasterize(r, image, tx, ty, scale, dst, w, 0, h, stride, 0);
+}
 
-			// now, traverse the scanlines and find the intersections on each scanline, use non-zero rule
-			nsvg__initPaint(&cache, &shape->stroke, shape->opacity);
+void nsvgRasterizeBandMask(NSVGrasterizer* r,
+						   NSVGimage* image, float tx, float ty, float scale,
+						   unsigned char* dst, int w, int y0, int rows, int stride)
+{
+	nsvg__rasterize(r, image, tx, ty, scale, dst, w, y0, rows, stride, 1);
+}
 
-			nsvg__rasterizeSortedEdges(r, tx,ty,scale, &cache, NSVG_FILLRULE_NONZERO);
+// Grows the buffer to hold at least n items, returns NULL on failure (buf stays valid)
+static void* nsvg__growBuffer(void* buf, int* capacity, int n, size_t size)
+{
+	int c = *capacity > 0 ? *capacity : 64;
+	if (n <= *capacity && buf != NULL) return buf;
+	while (c < n) c *= 2;
+	buf = realloc(buf, size * c);
+	if (buf != NULL) *capacity = c;
+	return buf;
+}
+
+// Returns the first bucket crossed by an edge starting at y (smallest k with y < (k+1)*bs).
+static int nsvg__firstBucket(float y, float bs, int nb)
+{
+	int k = y > 0.0f ? (int)(y / bs) : 0;
+	if (k >= nb) k = nb - 1;
+	// the rounded division may be one too large
+	while (k > 0 && y < (float)k * bs) k--;
+	return k;
+}
+
+// Returns the last bucket crossed by an edge ending at y (largest k with y > k*bs).
+static int nsvg__lastBucket(float y, float bs, int nb)
+{
+	int k = y > 0.0f ? (int)(y / bs) : 0;
+	if (k >= nb) k = nb - 1;
+	// the rounded division may be one too large
+	while (k > 0 && !(y > (float)k * bs)) k--;
+	return k;
+}
+
+// Adds the edges in r->edges as new layer to the prepared bands.
+static int nsvg__addBandLayer(NSVGrasterizer* r, NSVGpaint* paint, float opacity, char fillRule)
+{
+	NSVGbandLayer* layer;
+	NSVGedge* e;
+	void* p;
+	int nb = r->nbuckets;
+	float bs = (float)(r->bandRows * NSVG__SUBSAMPLES);
+	int base = r->nbandEdges;
+	int* edgeStart;
+	int* spillStart;
+	int i, k, first, last;
+
+	p = nsvg__growBuffer(r->bandLayers, &r->cbandLayers, r->nbandLayers + 1, sizeof(NSVGbandLayer));
+	if (p == NULL) return 0;
+	r->bandLayers = (NSVGbandLayer*)p;
+	p = nsvg__growBuffer(r->bandOffsets, &r->cbandOffsets, (r->nbandLayers + 1) * 2 * (nb + 1), sizeof(int));
+	if (p == NULL) return 0;
+	r->bandOffsets = (int*)p;
+
+	if (r->nbandEdges == 0) {
+		// take over the flattened edges instead of copying them
+		e = r->bandEdges;
+		i = r->cbandEdges;
+		r->bandEdges = r->edges;
+		r->cbandEdges = r->cedges;
+		r->edges = e;
+		r->cedges = i;
+	} else {
+		p = nsvg__growBuffer(r->bandEdges, &r->cbandEdges, r->nbandEdges + r->nedges, sizeof(NSVGedge));
+		if (p == NULL) return 0;
+		r->bandEdges = (NSVGedge*)p;
+		memcpy(r->bandEdges + r->nbandEdges, r->edges, sizeof(NSVGedge) * r->nedges);
+	}
+	r->nbandEdges += r->nedges;
+
+	layer = &r->bandLayers[r->nbandLayers];
+	nsvg__initPaint(&layer->cache, paint, opacity);
+	layer->fillRule = fillRule;
+	edgeStart = r->bandOffsets + r->nbandLayers * 2 * (nb + 1);
+	spillStart = edgeStart + nb + 1;
+	r->nbandLayers++;
+
+	// find the first edge of each bucket and count the edges continuing into later buckets
+	memset(spillStart, 0, sizeof(int) * (nb + 1));
+	k = 0;
+	for (i = base; i < r->nbandEdges; i++) {
+		e = &r->bandEdges[i];
+		first = nsvg__firstBucket(e->y0, bs, nb);
+		last = nsvg__lastBucket(e->y1, bs, nb);
+		while (k <= first) edgeStart[k++] = i;
+		for (first++; first <= last; first++) spillStart[first + 1]++;
+	}
+	while (k <= nb) edgeStart[k++] = r->nbandEdges;
+
+	// list the continuing edges per bucket in edge order
+	spillStart[0] = r->nbandSpill;
+	for (k = 0; k < nb; k++) spillStart[k + 1] += spillStart[k];
+	p = nsvg__growBuffer(r->bandSpill, &r->cbandSpill, spillStart[nb], sizeof(int));
+	if (p == NULL) return 0;
+	r->bandSpill = (int*)p;
+	r->nbandSpill = spillStart[nb];
+	for (i = base; i < r->nbandEdges; i++) {
+		e = &r->bandEdges[i];
+		first = nsvg__firstBucket(e->y0, bs, nb);
+		last = nsvg__lastBucket(e->y1, bs, nb);
+		for (first++; first <= last; first++) r->bandSpill[spillStart[first]++] = i;
+	}
+	// restore the start indices which were advanced while filling
+	for (k = nb; k > 0; k--) spillStart[k] = spillStart[k - 1];
+
+	return 1;
+}
+
+int nsvgPrepareBands(NSVGrasterizer* r,
+					 NSVGimage* image, float tx, float ty, float scale,
+					 int w, int h, int bandRows)
+{
+	NSVGshape *shape = NULL;
+
+	r->nbandEdges = 0;
+	r->nbandSpill = 0;
+	r->nbandLayers = 0;
+	r->nbuckets = 0;
+	if (w <= 0 || h <= 0 || bandRows <= 0) return 0;
+	r->bandRows = bandRows;
+	r->nbuckets = (h + bandRows - 1) / bandRows;
+	r->bandWidth = w;
+	r->bandTx = tx;
+	r->bandTy = ty;
+	r->bandScale = scale;
+
+	// cull the edges outside of the image
+	r->y0 = 0;
+	r->height = h;
+
+	for (shape = image->shapes; shape != NULL; shape = shape->next) {
+		if (!(shape->flags & NSVG_FLAGS_VISIBLE))
+			continue;
+
+		if (shape->fill.type != NSVG_PAINT_NONE) {
+			if (!nsvg__flattenLayer(r, shape, 0, tx, ty, scale) || !nsvg__addBandLayer(r, &shape->fill, shape->opacity, shape->fillRule))
+				goto error;
 		}
+		if (shape->stroke.type != NSVG_PAINT_NONE && (shape->strokeWidth * scale) > 0.01f) {
+			if (!nsvg__flattenLayer(r, shape, 1, tx, ty, scale) || !nsvg__addBandLayer(r, &shape->stroke, shape->opacity, NSVG_FILLRULE_NONZERO))
+				goto error;
+		}
+	}
+
+	// release the unused capacity of the flattened edges
+	if (r->nbandEdges > 0 && r->nbandEdges < r->cbandEdges) {
+		NSVGedge* e = (NSVGedge*)realloc(r->bandEdges, sizeof(NSVGedge) * r->nbandEdges);
+		if (e != NULL) {
+			r->bandEdges = e;
+			r->cbandEdges = r->nbandEdges;
+		}
+	}
+
+	r->y0 = 0;
+	r->height = 0;
+	return 1;
+
+error:
+	r->nbandLayers = 0;
+	r->y0 = 0;
+	r->height = 0;
+	return 0;
+}
+
+static void nsvg__rasterizePrepared(NSVGrasterizer* r, unsigned char* dst, int y0, int h, int stride)
+{
+	NSVGbandLayer* layer;
+	NSVGedge* e;
+	void* p;
+	int w = r->bandWidth;
+	int nb = r->nbuckets;
+	float ymin = (float)(y0 * NSVG__SUBSAMPLES);
+	float ymax = (float)((y0 + h) * NSVG__SUBSAMPLES);
+	int* edgeStart;
+	int* spillStart;
+	int i, l, ka, kb;
+
+	r->bitmap = dst;
+	r->width = w;
+	r->height = h;
+	r->stride = stride;
+	r->y0 = y0;
+	r->mask = 1;
+
+	if (w > r->cscanline) {
+		r->cscanline = w;
+		r->scanline = (unsigned char*)realloc(r->scanline, w);
+		if (r->scanline == NULL) return;
 	}
 
-	nsvg__unpremultiplyAlpha(dst, w, h, stride);
+	for (i = 0; i < h; i++)
+		memset(&dst[i*stride], 0, w);
+
+	// the band crosses the buckets ka to kb
+	ka = 0;
+	kb = 0;
+	if (nb > 0) {
+		ka = y0 > 0 ? y0 / r->bandRows : 0;
+		kb = (y0 + h - 1) / r->bandRows;
+		if (kb >= nb) kb = nb - 1;
+		if (ka > kb) ka = kb;
+	}
+
+	for (l = 0; l < r->nbandLayers; l++) {
+		layer = &r->bandLayers[l];
+		edgeStart = r->bandOffsets + l * 2 * (nb + 1);
+		spillStart = edgeStart + nb + 1;
+
+		p = nsvg__growBuffer(r->edges, &r->cedges, (spillStart[ka + 1] - spillStart[ka]) + (edgeStart[kb + 1] - edgeStart[ka]), sizeof(NSVGedge));
+		if (p == NULL) break;
+		r->edges = (NSVGedge*)p;
+
+		// edges from earlier buckets first, they start before all edges of bucket ka
+		r->nedges = 0;
+		for (i = spillStart[ka]; i < spillStart[ka + 1]; i++) {
+			e = &r->bandEdges[r->bandSpill[i]];
+			if (e->y1 > ymin && e->y0 < ymax)
+				r->edges[r->nedges++] = *e;
+		}
+		for (i = edgeStart[ka]; i < edgeStart[kb + 1]; i++) {
+			e = &r->bandEdges[i];
+			if (e->y0 >= ymax) break;
+			if (e->y1 > ymin)
+				r->edges[r->nedges++] = *e;
+		}
+
+		nsvg__rasterizeSortedEdges(r, r->bandTx, r->bandTy, r->bandScale, &layer->cache, layer->fillRule);
+	}
 
 	r->bitmap = NULL;
 	r->width = 0;
 	r->height = 0;
 	r->stride = 0;
+	r->y0 = 0;
+	r->mask = 0;
+}
+
+void nsvgRasterizePreparedBandMask(NSVGrasterizer* r,
+								   unsigned char* dst, int y0, int rows, int stride)
+{
+	nsvg__rasterizePrepared(r, dst, y0, rows, stride);
 }
 
 #endif // NANOSVGRAST_IMPLEMENTATION
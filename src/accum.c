@@ -0,0 +1,409 @@
+/**
+ * @file accum.c
+ * @author Daniel Starke
+ * @see accum.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "accum.h"
+#include "target.h"
+
+
+/**
+ * Creates a new accumulation buffer with all pixels cleared.
+ *
+ * @param[in] width - buffer width in pixels
+ * @param[in] height - buffer height in pixels
+ * @return created buffer or NULL on allocation error
+ */
+tAccum * acc_create(const int width, const int height) {
+	if (width < 1 || height < 1) return NULL;
+	const size_t count = (size_t)width * (size_t)height;
+	tAccum * acc = (tAccum *)malloc(sizeof(tAccum));
+	if (acc == NULL) return NULL;
+	memset(acc, 0, sizeof(tAccum));
+	acc->width = width;
+	acc->height = height;
+	acc->scale = 1.0f;
+	acc->weighted = (float *)calloc(count, sizeof(float));
+	acc->cover = (float *)calloc(count, sizeof(float));
+	if (acc->weighted == NULL || acc->cover == NULL) {
+		acc_delete(acc);
+		return NULL;
+	}
+	return acc;
+}
+
+
+/**
+ * Deletes the given accumulation buffer.
+ *
+ * @param[in,out] acc - buffer to delete
+ */
+void acc_delete(tAccum * acc) {
+	if (acc == NULL) return;
+	if (acc->weighted != NULL) free(acc->weighted);
+	if (acc->cover != NULL) free(acc->cover);
+	free(acc);
+}
+
+
+/**
+ * Clears the given buffer and moves it to the band of image rows starting at
+ * the passed row. Lines and curves are clipped to this band. The computed
+ * coverage is the same as for a buffer of the whole image.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] firstRow - image row of the first buffer row
+ */
+void acc_setBand(tAccum * acc, const int firstRow) {
+	const size_t count = (size_t)acc->width * (size_t)acc->height;
+	acc->firstRow = firstRow;
+	memset(acc->weighted, 0, count * sizeof(float));
+	memset(acc->cover, 0, count * sizeof(float));
+}
+
+
+/**
+ * Sets the transformation from workspace units to pixels which is applied
+ * to all subsequent lines and curves.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] tx - horizontal offset in pixels (applied after scaling)
+ * @param[in] ty - vertical offset in pixels (applied after scaling)
+ * @param[in] scale - scaling factor
+ * @param[in] lineWidth - line width in workspace units
+ */
+void acc_setTransform(tAccum * acc, const float tx, const float ty, const float scale, const float lineWidth) {
+	acc->tx = tx;
+	acc->ty = ty;
+	acc->scale = scale;
+	acc->halfWidth = 0.5f * lineWidth * scale;
+}
+
+
+/**
+ * Extends the given interval by the x coordinates of a row which lie within
+ * the passed distance to a point.
+ *
+ * @param[in,out] lo - lower interval bound
+ * @param[in,out] hi - upper interval bound
+ * @param[in] cx - point x coordinate in pixels
+ * @param[in] dy - vertical distance of the row to the point
+ * @param[in] r - distance limit
+ */
+static void diskRowSpan(float * lo, float * hi, const float cx, const float dy, const float r) {
+	const float h2 = (r * r) - (dy * dy);
+	if (h2 < 0.0f) return;
+	const float h = sqrtf(h2);
+	*lo = PCF_MIN(*lo, cx - h);
+	*hi = PCF_MAX(*hi, cx + h);
+}
+
+
+/**
+ * Extends the given interval by the x coordinates of a row which lie within
+ * the passed distance to a line, not including the areas beyond its end
+ * points.
+ *
+ * @param[in,out] lo - lower interval bound
+ * @param[in,out] hi - upper interval bound
+ * @param[in] x0 - start x coordinate of the line in pixels
+ * @param[in] py - vertical distance of the row to the line start
+ * @param[in] dx - horizontal line extent
+ * @param[in] dy - vertical line extent
+ * @param[in] len2 - squared line length (not zero)
+ * @param[in] rLen - distance limit multiplied by the line length
+ * @param[in] minX - lower bound used for unlimited intervals
+ * @param[in] maxX - upper bound used for unlimited intervals
+ */
+static void lineRowSpan(float * lo, float * hi, const float x0, const float py, const float dx, const float dy, const float len2, const float rLen, const float minX, const float maxX) {
+	float a = minX - x0;
+	float b = maxX - x0;
+	/* 0 <= t <= 1 with t = (px * dx + py * dy) / len2 */
+	const float t0 = -py * dy;
+	const float t1 = len2 - (py * dy);
+	if (dx != 0.0f) {
+		a = PCF_MAX(a, PCF_MIN(t0 / dx, t1 / dx));
+		b = PCF_MIN(b, PCF_MAX(t0 / dx, t1 / dx));
+	} else if (t0 > 0.0f || t1 < 0.0f) {
+		return;
+	}
+	/* |px * dy - py * dx| <= r * len */
+	const float n = py * dx;
+	if (dy != 0.0f) {
+		a = PCF_MAX(a, PCF_MIN((n - rLen) / dy, (n + rLen) / dy));
+		b = PCF_MIN(b, PCF_MAX((n - rLen) / dy, (n + rLen) / dy));
+	} else if (fabsf(n) > rLen) {
+		return;
+	}
+	if (a > b) return;
+	*lo = PCF_MIN(*lo, x0 + a);
+	*hi = PCF_MAX(*hi, x0 + b);
+}
+
+
+/**
+ * Adds the given line in pixel coordinates to the buffer. The coverage of each
+ * pixel is approximated by the overlap of the pixel with a band of the line
+ * width at the distance of the pixel center to the line. The line body is
+ * half-open to avoid counting joints of connected lines twice.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] x0 - start x coordinate in pixels
+ * @param[in] y0 - start y coordinate in pixels
+ * @param[in] x1 - end x coordinate in pixels
+ * @param[in] y1 - end y coordinate in pixels
+ * @param[in] weight - line weight (0..1)
+ * @param[in] caps - line caps (see tAccumCap)
+ */
+static void addPixelLine(tAccum * acc, const float x0, const float y0, const float x1, const float y1, const float weight, const int caps) {
+	const float hw = acc->halfWidth;
+	const float dx = x1 - x0;
+	const float dy = y1 - y0;
+	const float len2 = (dx * dx) + (dy * dy);
+	const float invLen2 = (len2 > 1e-12f) ? (1.0f / len2) : 0.0f;
+	if (invLen2 == 0.0f && caps == ACCUM_CAP_NONE) return;
+	/* pixels with a center farther away than this are not covered */
+	const float reach = hw + 0.5f;
+	int xStart = (int)floorf(PCF_MIN(x0, x1) - reach);
+	int xEnd = (int)floorf(PCF_MAX(x0, x1) + reach);
+	int yStart = (int)floorf(PCF_MIN(y0, y1) - reach);
+	int yEnd = (int)floorf(PCF_MAX(y0, y1) + reach);
+	if (xStart < 0) xStart = 0;
+	if (yStart < acc->firstRow) yStart = acc->firstRow;
+	if (xEnd >= acc->width) xEnd = acc->width - 1;
+	if (yEnd >= (acc->firstRow + acc->height)) yEnd = acc->firstRow + acc->height - 1;
+	const float len = sqrtf(len2);
+	for (int y = yStart; y <= yEnd; y++) {
+		const float py = ((float)y + 0.5f) - y0;
+		/* limit the row to the pixel centers within reach of the line body and caps */
+		float lo = (float)xEnd + 1.0f;
+		float hi = (float)xStart - 1.0f;
+		if (invLen2 != 0.0f) {
+			lineRowSpan(&lo, &hi, x0, py, dx, dy, len2, reach * len, (float)xStart - 1.0f, (float)xEnd + 1.0f);
+		}
+		if ((caps & ACCUM_CAP_START) != 0) diskRowSpan(&lo, &hi, x0, py, reach);
+		if ((caps & ACCUM_CAP_END) != 0) diskRowSpan(&lo, &hi, x1, ((float)y + 0.5f) - y1, reach);
+		if (lo > hi) continue;
+		/* one pixel margin to evaluate all pixels the exact per-pixel test accepts */
+		const int xFirst = PCF_MAX(xStart, (int)floorf(lo - 0.5f) - 1);
+		const int xLast = PCF_MIN(xEnd, (int)floorf(hi - 0.5f) + 1);
+		float * weighted = acc->weighted + ((size_t)(y - acc->firstRow) * (size_t)acc->width);
+		float * cover = acc->cover + ((size_t)(y - acc->firstRow) * (size_t)acc->width);
+		for (int x = xFirst; x <= xLast; x++) {
+			const float px = ((float)x + 0.5f) - x0;
+			float t = ((px * dx) + (py * dy)) * invLen2;
+			if (t < 0.0f) {
+				if ((caps & ACCUM_CAP_START) == 0) continue;
+				t = 0.0f;
+			} else if (t >= 1.0f) {
+				if ((caps & ACCUM_CAP_END) == 0) continue;
+				t = 1.0f;
+			}
+			const float qx = px - (t * dx);
+			const float qy = py - (t * dy);
+			const float d = sqrtf((qx * qx) + (qy * qy));
+			const float c = PCF_MIN(d + hw, 0.5f) - PCF_MAX(d - hw, -0.5f);
+			if (c <= 0.0f) continue;
+			weighted[x] += weight * c;
+			cover[x] += c;
+		}
+	}
+}
+
+
+/**
+ * Flattens the given cubic bezier curve in pixel coordinates to lines.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] p - 8 coordinates of the curve
+ * @param[in] weight - curve weight (0..1)
+ * @param[in] caps - line caps (see tAccumCap)
+ * @param[in] level - recursion level
+ */
+static void flattenCubic(tAccum * acc, const float * p, const float weight, const int caps, const int level) {
+	const float dx = p[6] - p[0];
+	const float dy = p[7] - p[1];
+	const float d2 = fabsf(((p[2] - p[6]) * dy) - ((p[3] - p[7]) * dx));
+	const float d3 = fabsf(((p[4] - p[6]) * dy) - ((p[5] - p[7]) * dx));
+	if (level > 10 || ((d2 + d3) * (d2 + d3)) < (ACCUM_TESS_TOL * ((dx * dx) + (dy * dy)))) {
+		addPixelLine(acc, p[0], p[1], p[6], p[7], weight, caps);
+		return;
+	}
+	/* split at t = 0.5 */
+	float l[8], r[8];
+	const float x12 = (p[0] + p[2]) * 0.5f, y12 = (p[1] + p[3]) * 0.5f;
+	const float x23 = (p[2] + p[4]) * 0.5f, y23 = (p[3] + p[5]) * 0.5f;
+	const float x34 = (p[4] + p[6]) * 0.5f, y34 = (p[5] + p[7]) * 0.5f;
+	const float x123 = (x12 + x23) * 0.5f, y123 = (y12 + y23) * 0.5f;
+	const float x234 = (x23 + x34) * 0.5f, y234 = (y23 + y34) * 0.5f;
+	const float x1234 = (x123 + x234) * 0.5f, y1234 = (y123 + y234) * 0.5f;
+	l[0] = p[0]; l[1] = p[1]; l[2] = x12; l[3] = y12; l[4] = x123; l[5] = y123; l[6] = x1234; l[7] = y1234;
+	r[0] = x1234; r[1] = y1234; r[2] = x234; r[3] = y234; r[4] = x34; r[5] = y34; r[6] = p[6]; r[7] = p[7];
+	flattenCubic(acc, l, weight, caps & ACCUM_CAP_START, level + 1);
+	flattenCubic(acc, r, weight, caps & ACCUM_CAP_END, level + 1);
+}
+
+
+/**
+ * Adds the given cubic bezier curve in workspace coordinates to the buffer.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] pts - 8 coordinates of the curve (start, 2 control points, end)
+ * @param[in] weight - curve weight (0..1)
+ * @param[in] caps - line caps (see tAccumCap)
+ */
+void acc_addCubic(tAccum * acc, const float * pts, const float weight, const int caps) {
+	float p[8];
+	for (size_t i = 0; i < 8; i += 2) {
+		p[i] = (pts[i] * acc->scale) + acc->tx;
+		p[i + 1] = (pts[i + 1] * acc->scale) + acc->ty;
+	}
+	/* skip curves outside the buffer rows (the curve lies within the bounds of its control points) */
+	const float reach = acc->halfWidth + 0.5f;
+	const float yMin = PCF_MIN(PCF_MIN(p[1], p[3]), PCF_MIN(p[5], p[7]));
+	const float yMax = PCF_MAX(PCF_MAX(p[1], p[3]), PCF_MAX(p[5], p[7]));
+	if ((yMax + reach) < (float)acc->firstRow || (yMin - reach) > (float)(acc->firstRow + acc->height)) return;
+	flattenCubic(acc, p, weight, caps, 0);
+}
+
+
+/**
+ * Adds the coverage of a line cap around the given end point for the pixels
+ * of a single row which lie outside the line body.
+ *
+ * @param[in,out] weighted - weighted coverage row
+ * @param[in,out] cover - coverage row
+ * @param[in] xStart - first pixel column to check
+ * @param[in] xEnd - last pixel column to check
+ * @param[in] ex - end point x coordinate in pixels
+ * @param[in] dy - vertical distance of the pixel center row to the end point
+ * @param[in] hw - half line width in pixels
+ * @param[in] weight - line weight (0..1)
+ */
+static void addCapRow(float * weighted, float * cover, const int xStart, const int xEnd, const float ex, const float dy, const float hw, const float weight) {
+	for (int x = xStart; x <= xEnd; x++) {
+		const float dx = ((float)x + 0.5f) - ex;
+		const float d = sqrtf((dx * dx) + (dy * dy));
+		const float c = PCF_MIN(d + hw, 0.5f) - PCF_MAX(d - hw, -0.5f);
+		if (c <= 0.0f) continue;
+		weighted[x] += weight * c;
+		cover[x] += c;
+	}
+}
+
+
+/**
+ * Adds the given horizontal line in workspace coordinates to the buffer.
+ * The distance of all pixel centers within a row to the line is the same.
+ * Hence, the coverage is computed once per row and added to the whole
+ * horizontal run of pixels. This gives the same result as addPixelLine() at
+ * a fraction of the cost.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] x0 - start x coordinate (needs to be less or equal to x1)
+ * @param[in] x1 - end x coordinate
+ * @param[in] y - y coordinate
+ * @param[in] weight - line weight (0..1)
+ * @param[in] caps - line caps (see tAccumCap)
+ */
+void acc_addSpan(tAccum * acc, float x0, float x1, float y, const float weight, const int caps) {
+	const float hw = acc->halfWidth;
+	const float reach = hw + 0.5f;
+	x0 = (x0 * acc->scale) + acc->tx;
+	x1 = (x1 * acc->scale) + acc->tx;
+	y = (y * acc->scale) + acc->ty;
+	/* pixel columns with their center in [x0, x1) belong to the line body */
+	int bodyStart = (int)ceilf(x0 - 0.5f);
+	int bodyEnd = (int)ceilf(x1 - 0.5f) - 1;
+	int capStart = (int)floorf(x0 - reach);
+	int capEnd = (int)floorf(x1 + reach);
+	int yStart = (int)floorf(y - reach);
+	int yEnd = (int)floorf(y + reach);
+	if (bodyStart < 0) bodyStart = 0;
+	if (bodyEnd >= acc->width) bodyEnd = acc->width - 1;
+	if (capStart < 0) capStart = 0;
+	if (capEnd >= acc->width) capEnd = acc->width - 1;
+	if (yStart < acc->firstRow) yStart = acc->firstRow;
+	if (yEnd >= (acc->firstRow + acc->height)) yEnd = acc->firstRow + acc->height - 1;
+	for (int row = yStart; row <= yEnd; row++) {
+		const float dy = ((float)row + 0.5f) - y;
+		const float d = fabsf(dy);
+		const float c = PCF_MIN(d + hw, 0.5f) - PCF_MAX(d - hw, -0.5f);
+		float * weighted = acc->weighted + ((size_t)(row - acc->firstRow) * (size_t)acc->width);
+		float * cover = acc->cover + ((size_t)(row - acc->firstRow) * (size_t)acc->width);
+		if (c > 0.0f) {
+			const float wc = weight * c;
+			for (int x = bodyStart; x <= bodyEnd; x++) {
+				weighted[x] += wc;
+				cover[x] += c;
+			}
+		}
+		if ((caps & ACCUM_CAP_START) != 0) {
+			addCapRow(weighted, cover, capStart, PCF_MIN(bodyStart - 1, capEnd), x0, dy, hw, weight);
+		}
+		if ((caps & ACCUM_CAP_END) != 0) {
+			addCapRow(weighted, cover, PCF_MAX(bodyEnd + 1, capStart), capEnd, x1, dy, hw, weight);
+		}
+	}
+}
+
+
+/**
+ * Composites the accumulated coverage over the passed 8-bit coverage mask.
+ * The weights are ignored.
+ *
+ * @param[in] acc - accumulation buffer
+ * @param[in,out] mask - coverage mask with the size of the accumulation buffer
+ */
+void acc_compositeMask(const tAccum * acc, unsigned char * mask) {
+	const size_t count = (size_t)acc->width * (size_t)acc->height;
+	for (size_t i = 0; i < count; i++) {
+		const float c = acc->cover[i];
+		if (c <= 0.0f) continue;
+		const unsigned int a = (c >= 1.0f) ? 255 : (unsigned int)((c * 255.0f) + 0.5f);
+		mask[i] = (unsigned char)(a + ((mask[i] * (255 - a)) + 127) / 255);
+	}
+}
+
+
+/**
+ * Tone maps the accumulated values to an opaque RGBA image. The mean weight
+ * of each pixel blends between the background and foreground color.
+ *
+ * @param[in] acc - accumulation buffer
+ * @param[out] img - RGBA image with the size of the accumulation buffer
+ * @param[in] bg - background color in ABGR (alpha is ignored)
+ * @param[in] fg - foreground color in ABGR (alpha is ignored)
+ */
+void acc_toImage(const tAccum * acc, unsigned char * img, const unsigned int bg, const unsigned int fg) {
+	const size_t count = (size_t)acc->width * (size_t)acc->height;
+	for (size_t i = 0; i < count; i++, img += 4) {
+		const float c = acc->cover[i];
+		float v = acc->weighted[i] / PCF_MAX(c, 1.0f);
+		if (v > 1.0f) v = 1.0f;
+		const unsigned int a = (v > 0.0f) ? (unsigned int)((v * 255.0f) + 0.5f) : 0;
+		const unsigned int ia = 255 - a;
+		img[0] = (unsigned char)((((bg & 0xFF) * ia) + ((fg & 0xFF) * a) + 127) / 255);
+		img[1] = (unsigned char)(((((bg >> 8) & 0xFF) * ia) + (((fg >> 8) & 0xFF) * a) + 127) / 255);
+		img[2] = (unsigned char)(((((bg >> 16) & 0xFF) * ia) + (((fg >> 16) & 0xFF) * a) + 127) / 255);
+		img[3] = 255; /* opaque */
+	}
+}
@@ -0,0 +1,78 @@
+/**
+ * @file accum.h
+ * @author Daniel Starke
+ * @see accum.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __ACCUM_H__
+#define __ACCUM_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Flatness tolerance in pixels used to split cubic bezier curves into lines. */
+#define ACCUM_TESS_TOL 0.25f
+
+
+/** Line cap flags for acc_addCubic() and acc_addSpan(). */
+typedef enum {
+	ACCUM_CAP_NONE  = 0x00, /**< no caps (line continues at both ends) */
+	ACCUM_CAP_START = 0x01, /**< round cap at the start point */
+	ACCUM_CAP_END   = 0x02, /**< round cap at the end point */
+	ACCUM_CAP_BOTH  = 0x03  /**< round cap at both ends */
+} tAccumCap;
+
+
+/**
+ * Defines the power accumulation buffer. Each pixel accumulates the weighted
+ * coverage and the plain coverage of all lines drawn. The weighted coverage
+ * divided by the coverage (clamped to 1) gives the mean weight of the pixel.
+ */
+typedef struct {
+	int width;        /**< Buffer width in pixels. */
+	int height;       /**< Buffer height in pixels. */
+	int firstRow;     /**< Image row of the first buffer row (for band rendering). */
+	float tx;         /**< Horizontal offset in pixels (applied after scaling). */
+	float ty;         /**< Vertical offset in pixels (applied after scaling). */
+	float scale;      /**< Scaling factor from workspace units to pixels. */
+	float halfWidth;  /**< Half line width in pixels. */
+	float * weighted; /**< Accumulated weight multiplied by coverage per pixel. */
+	float * cover;    /**< Accumulated coverage per pixel. */
+} tAccum;
+
+
+tAccum * acc_create(const int width, const int height);
+void acc_delete(tAccum * acc);
+void acc_setBand(tAccum * acc, const int firstRow);
+void acc_setTransform(tAccum * acc, const float tx, const float ty, const float scale, const float lineWidth);
+void acc_addCubic(tAccum * acc, const float * pts, const float weight, const int caps);
+void acc_addSpan(tAccum * acc, float x0, float x1, float y, const float weight, const int caps);
+void acc_compositeMask(const tAccum * acc, unsigned char * mask);
+void acc_toImage(const tAccum * acc, unsigned char * img, const unsigned int bg, const unsigned int fg);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __ACCUM_H__ */
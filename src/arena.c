@@ -0,0 +1,139 @@
+/**
+ * @file arena.c
+ * @author Daniel Starke
+ * @see arena.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+
+/** Size of the block header rounded up to the allocation alignment. */
+#define ARENA_HEADER_SIZE (((sizeof(tArenaBlock) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT)
+
+
+/**
+ * Returns the data of the given block.
+ *
+ * @param[in] block - memory block
+ * @return pointer to the first usable byte
+ */
+static inline unsigned char * blockData(tArenaBlock * block) {
+	return ((unsigned char *)block) + ARENA_HEADER_SIZE;
+}
+
+
+/**
+ * Creates a new arena. No memory block is allocated until the first
+ * allocation is performed.
+ *
+ * @param[in] blockSize - minimum size of a memory block in bytes (0 for default)
+ * @return created arena or NULL on allocation error
+ */
+tArena * arena_create(const size_t blockSize) {
+	tArena * arena = (tArena *)malloc(sizeof(tArena));
+	if (arena == NULL) return NULL;
+	memset(arena, 0, sizeof(tArena));
+	arena->blockSize = (blockSize > 0) ? blockSize : (size_t)ARENA_BLOCK_SIZE;
+	return arena;
+}
+
+
+/**
+ * Deletes the given arena and all its memory blocks.
+ *
+ * @param[in,out] arena - arena to delete
+ */
+void arena_delete(tArena * arena) {
+	if (arena == NULL) return;
+	tArenaBlock * block = arena->head;
+	while (block != NULL) {
+		tArenaBlock * next = block->next;
+		free(block);
+		block = next;
+	}
+	free(arena);
+}
+
+
+/**
+ * Allocates the given number of bytes from the arena. The returned memory
+ * is uninitialized and remains valid until the arena is reset or deleted.
+ *
+ * @param[in,out] arena - arena to allocate from
+ * @param[in] size - number of bytes to allocate
+ * @return allocated memory or NULL on allocation error
+ */
+void * arena_alloc(tArena * arena, const size_t size) {
+	if (arena == NULL) return NULL;
+	const size_t alignedSize = ((size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT;
+	if (alignedSize < size) return NULL; /* overflow */
+	tArenaBlock * block = arena->current;
+	/* find the next block with enough space (all following blocks are unused) */
+	while (block != NULL && (block->size - block->used) < alignedSize) {
+		block = block->next;
+		if (block != NULL) block->used = 0;
+	}
+	if (block == NULL) {
+		/* append a new block */
+		const size_t blockSize = (alignedSize > arena->blockSize) ? alignedSize : arena->blockSize;
+		block = (tArenaBlock *)malloc(ARENA_HEADER_SIZE + blockSize);
+		if (block == NULL) return NULL;
+		block->size = blockSize;
+		block->used = 0;
+		if (arena->current == NULL) {
+			block->next = arena->head;
+			arena->head = block;
+		} else {
+			/* insert after the current block to keep the unused blocks */
+			block->next = arena->current->next;
+			arena->current->next = block;
+		}
+	}
+	arena->current = block;
+	void * ptr = blockData(block) + block->used;
+	block->used += alignedSize;
+	return ptr;
+}
+
+
+/**
+ * Allocates the given number of bytes from the arena and clears them.
+ *
+ * @param[in,out] arena - arena to allocate from
+ * @param[in] size - number of bytes to allocate
+ * @return allocated memory or NULL on allocation error
+ */
+void * arena_calloc(tArena * arena, const size_t size) {
+	void * ptr = arena_alloc(arena, size);
+	if (ptr != NULL) memset(ptr, 0, size);
+	return ptr;
+}
+
+
+/**
+ * Releases all allocations of the given arena at once. The memory blocks are
+ * kept and reused by subsequent allocations.
+ *
+ * @param[in,out] arena - arena to reset
+ */
+void arena_reset(tArena * arena) {
+	if (arena == NULL) return;
+	arena->current = arena->head;
+	if (arena->head != NULL) arena->head->used = 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file arena.h
+ * @author Daniel Starke
+ * @see arena.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Default size of a single arena memory block in bytes. */
+#define ARENA_BLOCK_SIZE 0x100000UL
+
+/** Alignment of all allocations in bytes. */
+#define ARENA_ALIGNMENT 16
+
+
+/** Defines a single memory block of an arena. The data follows the header. */
+typedef struct tArenaBlock {
+	struct tArenaBlock * next; /**< Next block or NULL. */
+	size_t size;               /**< Usable size of this block in bytes. */
+	size_t used;               /**< Used size of this block in bytes. */
+} tArenaBlock;
+
+
+/**
+ * Defines a bump allocator. Objects are allocated linearly from a list of
+ * memory blocks and released all at once. The blocks are kept for reuse.
+ */
+typedef struct {
+	tArenaBlock * head;    /**< First memory block. */
+	tArenaBlock * current; /**< Memory block used for the next allocation. */
+	size_t blockSize;      /**< Minimum size of a new memory block in bytes. */
+} tArena;
+
+
+tArena * arena_create(const size_t blockSize);
+void arena_delete(tArena * arena);
+void * arena_alloc(tArena * arena, const size_t size);
+void * arena_calloc(tArena * arena, const size_t size);
+void arena_reset(tArena * arena);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __ARENA_H__ */
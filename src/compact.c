@@ -0,0 +1,185 @@
+/**
+ * @file compact.c
+ * @author Daniel Starke
+ * @see compact.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The path points are given as cubic bezier curves (start point followed by
+ * two control points and the end point per curve). The start point is not
+ * encoded. It serves as origin for all other points. Each curve is encoded as:
+ * - zigzag varint of (dx << 1 | isCurve)
+ * - zigzag varint of dy
+ * - only if isCurve: zigzag varints of both control points relative to the curve start point
+ * The deltas are fixed-point values with COMPACT_SCALE units per millimeter.
+ * Straight lines (control points at 1/3 and 2/3) only need the end point.
+ */
+#include <math.h>
+#include <stdint.h>
+#include "compact.h"
+
+
+/** Maximum number of bytes of a single varint encoded 32-bit value. */
+#define MAX_VARINT_SIZE 5
+
+
+/**
+ * Quantizes the given coordinate relative to the passed origin.
+ *
+ * @param[in] value - coordinate
+ * @param[in] origin - origin coordinate
+ * @return fixed-point value
+ */
+static inline int32_t quantize(const float value, const float origin) {
+	return (int32_t)lrintf((value - origin) * COMPACT_SCALE);
+}
+
+
+/**
+ * Writes the given signed value as zigzag varint.
+ *
+ * @param[out] out - output buffer
+ * @param[in] value - value to write
+ * @return pointer past the written bytes
+ */
+static inline unsigned char * putVarint(unsigned char * out, const int32_t value) {
+	uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	while (v >= 0x80) {
+		*out++ = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	*out++ = (unsigned char)v;
+	return out;
+}
+
+
+/**
+ * Reads a zigzag varint.
+ *
+ * @param[in,out] data - input pointer (advanced past the read bytes)
+ * @return read value
+ */
+static inline int32_t getVarint(const unsigned char ** data) {
+	const unsigned char * in = *data;
+	uint32_t v = 0;
+	unsigned int shift = 0;
+	for (;;) {
+		const uint32_t b = *in++;
+		v |= (b & 0x7F) << shift;
+		if (b < 0x80) break;
+		shift += 7;
+	}
+	*data = in;
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+
+/**
+ * Returns the maximum number of bytes needed to encode a path with the
+ * given number of points.
+ *
+ * @param[in] npts - number of points
+ * @return maximum encoded size in bytes
+ */
+size_t cp_maxEncodedSize(const size_t npts) {
+	/* 6 coordinates per curve, one of them with an additional flag bit */
+	return ((npts / 3) + 1) * 6 * MAX_VARINT_SIZE;
+}
+
+
+/**
+ * Encodes the given path points in the compact format. The first point is
+ * not encoded and needs to be stored by the caller.
+ *
+ * @param[out] out - output buffer with at least cp_maxEncodedSize() bytes
+ * @param[in] pts - path points (x/y pairs)
+ * @param[in] npts - number of path points
+ * @return number of bytes written
+ */
+size_t cp_encodePath(unsigned char * out, const float * pts, const size_t npts) {
+	unsigned char * ptr = out;
+	const float x0 = pts[0];
+	const float y0 = pts[1];
+	int32_t qx = 0, qy = 0;
+	for (size_t i = 0; (i + 3) < npts; i += 3) {
+		const float * p = pts + (2 * i);
+		const float dx = p[6] - p[0];
+		const float dy = p[7] - p[1];
+		/* control points as created for straight lines (within a quarter of the resolution) */
+		const float tol = 0.25f / COMPACT_SCALE;
+		const int isCurve = (
+			fabsf(p[2] - (p[0] + (dx / 3.0f))) > tol || fabsf(p[3] - (p[1] + (dy / 3.0f))) > tol ||
+			fabsf(p[4] - (p[6] - (dx / 3.0f))) > tol || fabsf(p[5] - (p[7] - (dy / 3.0f))) > tol
+		) ? 1 : 0;
+		const int32_t ex = quantize(p[6], x0);
+		const int32_t ey = quantize(p[7], y0);
+		/* the flag bit is stored in the LSB of the first value */
+		ptr = putVarint(ptr, (int32_t)((uint32_t)(ex - qx) << 1) | isCurve);
+		ptr = putVarint(ptr, ey - qy);
+		if (isCurve != 0) {
+			ptr = putVarint(ptr, quantize(p[2], x0) - qx);
+			ptr = putVarint(ptr, quantize(p[3], y0) - qy);
+			ptr = putVarint(ptr, quantize(p[4], x0) - qx);
+			ptr = putVarint(ptr, quantize(p[5], y0) - qy);
+		}
+		qx = ex;
+		qy = ey;
+	}
+	return (size_t)(ptr - out);
+}
+
+
+/**
+ * Decodes the given compact path data.
+ *
+ * @param[out] pts - path points (x/y pairs) for npts points
+ * @param[in] data - encoded path data
+ * @param[in] npts - number of path points
+ * @param[in] x0 - x coordinate of the first point
+ * @param[in] y0 - y coordinate of the first point
+ */
+void cp_decodePath(float * pts, const unsigned char * data, const size_t npts, const float x0, const float y0) {
+	static const float unit = 1.0f / COMPACT_SCALE;
+	int32_t qx = 0, qy = 0;
+	pts[0] = x0;
+	pts[1] = y0;
+	for (size_t i = 0; (i + 3) < npts; i += 3) {
+		float * p = pts + (2 * i);
+		const int32_t first = getVarint(&data);
+		const int isCurve = first & 1;
+		qx += first >> 1;
+		qy += getVarint(&data);
+		p[6] = x0 + ((float)qx * unit);
+		p[7] = y0 + ((float)qy * unit);
+		if (isCurve != 0) {
+			const int32_t c1x = getVarint(&data);
+			const int32_t c1y = getVarint(&data);
+			const int32_t c2x = getVarint(&data);
+			const int32_t c2y = getVarint(&data);
+			p[2] = p[0] + ((float)c1x * unit);
+			p[3] = p[1] + ((float)c1y * unit);
+			p[4] = p[0] + ((float)c2x * unit);
+			p[5] = p[1] + ((float)c2y * unit);
+		} else {
+			const float dx = p[6] - p[0];
+			const float dy = p[7] - p[1];
+			p[2] = p[0] + (dx / 3.0f);
+			p[3] = p[1] + (dy / 3.0f);
+			p[4] = p[6] - (dx / 3.0f);
+			p[5] = p[7] - (dy / 3.0f);
+		}
+	}
+}
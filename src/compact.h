@@ -0,0 +1,46 @@
+/**
+ * @file compact.h
+ * @author Daniel Starke
+ * @see compact.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __COMPACT_H__
+#define __COMPACT_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Fixed-point resolution of the compact encoding in units per millimeter. */
+#define COMPACT_SCALE 1024.0f
+
+
+size_t cp_maxEncodedSize(const size_t npts);
+size_t cp_encodePath(unsigned char * out, const float * pts, const size_t npts);
+void cp_decodePath(float * pts, const unsigned char * data, const size_t npts, const float x0, const float y0);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __COMPACT_H__ */
@@ -2,6 +2,6 @@ CWFLAGS = -Wall -Wextra -Wformat -pedantic -Wshadow -Wno-format -std=c99
 CFLAGS = -O2 -DNDEBUG -D_BSD_SOURCE -D_POSIX_C_SOURCE=200112L -D_XOPEN_SOURCE -mtune=core2 -march=core2 -mstackrealign -fomit-frame-pointer -fno-ident -D_FILE_OFFSET_BITS=64
 LDFLAGS = -s -fno-ident
 PATHS = 
-LIBS = -lpng -lz -lm
+LIBS = -lpng -lz -lm -lpthread
 OBJEXT = .o
 BINEXT = 
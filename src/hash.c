@@ -0,0 +1,231 @@
+/**
+ * @file hash.c
+ * @author Daniel Starke
+ * @see hash.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include "hash.h"
+#include "target.h"
+
+
+#define PRIME64_1 UINT64_C(0x9E3779B185EBCA87)
+#define PRIME64_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 UINT64_C(0x165667B19E3779F9)
+#define PRIME64_4 UINT64_C(0x85EBCA77C2B2AE63)
+#define PRIME64_5 UINT64_C(0x27D4EB2F165667C5)
+
+
+/**
+ * Rotates the given value to the left.
+ *
+ * @param[in] x - value to rotate
+ * @param[in] r - number of bits to rotate (1..63)
+ * @return rotated value
+ */
+static inline uint64_t rotl64(const uint64_t x, const int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+
+/**
+ * Reads a 64-bit little endian value from the given unaligned memory.
+ *
+ * @param[in] p - memory to read from
+ * @return read value
+ */
+static inline uint64_t read64(const unsigned char * p) {
+	return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+		| ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+
+/**
+ * Reads a 32-bit little endian value from the given unaligned memory.
+ *
+ * @param[in] p - memory to read from
+ * @return read value
+ */
+static inline uint64_t read32(const unsigned char * p) {
+	return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24);
+}
+
+
+/**
+ * Mixes the given input into an accumulator lane.
+ *
+ * @param[in] acc - accumulator lane value
+ * @param[in] input - input value
+ * @return new accumulator lane value
+ */
+static inline uint64_t round64(uint64_t acc, const uint64_t input) {
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+
+/**
+ * Merges an accumulator lane into the final hash value.
+ *
+ * @param[in] acc - hash value
+ * @param[in] val - accumulator lane value
+ * @return new hash value
+ */
+static inline uint64_t merge64(uint64_t acc, const uint64_t val) {
+	acc ^= round64(0, val);
+	return (acc * PRIME64_1) + PRIME64_4;
+}
+
+
+/**
+ * Processes the given 32 byte stripes.
+ *
+ * @param[in,out] v - accumulator lanes
+ * @param[in] p - data to process
+ * @param[in] count - number of stripes
+ */
+static void processStripes(uint64_t * v, const unsigned char * p, size_t count) {
+	uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+	for (; count > 0; count--, p += 32) {
+		v1 = round64(v1, read64(p));
+		v2 = round64(v2, read64(p + 8));
+		v3 = round64(v3, read64(p + 16));
+		v4 = round64(v4, read64(p + 24));
+	}
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
+	v[3] = v4;
+}
+
+
+/**
+ * Initializes the given hash state.
+ *
+ * @param[out] h - hash state
+ * @param[in] seed - seed value
+ */
+void hash_init(tHash * h, const uint64_t seed) {
+	if (h == NULL) return;
+	memset(h, 0, sizeof(*h));
+	h->seed = seed;
+	h->v[0] = seed + PRIME64_1 + PRIME64_2;
+	h->v[1] = seed + PRIME64_2;
+	h->v[2] = seed;
+	h->v[3] = seed - PRIME64_1;
+}
+
+
+/**
+ * Adds the given data to the hash calculation.
+ *
+ * @param[in,out] h - hash state
+ * @param[in] data - data to add
+ * @param[in] size - number of bytes in data
+ */
+void hash_update(tHash * h, const void * data, const size_t size) {
+	const unsigned char * p = (const unsigned char *)data;
+	size_t len = size;
+	if (h == NULL || p == NULL || len < 1) return;
+	h->total += (uint64_t)len;
+	if (h->bufSize > 0) {
+		/* complete the pending stripe */
+		const size_t n = PCF_MIN(len, sizeof(h->buf) - h->bufSize);
+		memcpy(h->buf + h->bufSize, p, n);
+		h->bufSize += n;
+		p += n;
+		len -= n;
+		if (h->bufSize < sizeof(h->buf)) return;
+		processStripes(h->v, h->buf, 1);
+		h->bufSize = 0;
+	}
+	if (len >= 32) {
+		processStripes(h->v, p, len / 32);
+		p += len & ~(size_t)31;
+		len &= 31;
+	}
+	if (len > 0) {
+		memcpy(h->buf, p, len);
+		h->bufSize = len;
+	}
+}
+
+
+/**
+ * Returns the hash value of all data added so far. The hash state is not
+ * modified and more data may be added afterwards.
+ *
+ * @param[in] h - hash state
+ * @return hash value
+ */
+uint64_t hash_final(const tHash * h) {
+	const unsigned char * p;
+	size_t len;
+	uint64_t res;
+	if (h == NULL) return 0;
+	if (h->total >= 32) {
+		res = rotl64(h->v[0], 1) + rotl64(h->v[1], 7) + rotl64(h->v[2], 12) + rotl64(h->v[3], 18);
+		res = merge64(res, h->v[0]);
+		res = merge64(res, h->v[1]);
+		res = merge64(res, h->v[2]);
+		res = merge64(res, h->v[3]);
+	} else {
+		res = h->seed + PRIME64_5;
+	}
+	res += h->total;
+	/* process the remaining bytes */
+	p = h->buf;
+	len = h->bufSize;
+	for (; len >= 8; len -= 8, p += 8) {
+		res ^= round64(0, read64(p));
+		res = (rotl64(res, 27) * PRIME64_1) + PRIME64_4;
+	}
+	if (len >= 4) {
+		res ^= read32(p) * PRIME64_1;
+		res = (rotl64(res, 23) * PRIME64_2) + PRIME64_3;
+		len -= 4;
+		p += 4;
+	}
+	for (; len > 0; len--, p++) {
+		res ^= (uint64_t)(*p) * PRIME64_5;
+		res = rotl64(res, 11) * PRIME64_1;
+	}
+	/* avalanche */
+	res ^= res >> 33;
+	res *= PRIME64_2;
+	res ^= res >> 29;
+	res *= PRIME64_3;
+	res ^= res >> 32;
+	return res;
+}
+
+
+/**
+ * Formats the given hash value as lower case hexadecimal string.
+ *
+ * @param[out] str - output string with at least HASH_STR_LEN + 1 characters
+ * @param[in] value - hash value
+ */
+void hash_toStr(char * str, const uint64_t value) {
+	static const char hex[] = "0123456789abcdef";
+	if (str == NULL) return;
+	for (int i = HASH_STR_LEN - 1, shift = 0; i >= 0; i--, shift += 4) {
+		str[i] = hex[(value >> shift) & 0xF];
+	}
+	str[HASH_STR_LEN] = 0;
+}
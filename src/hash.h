@@ -0,0 +1,62 @@
+/**
+ * @file hash.h
+ * @author Daniel Starke
+ * @see hash.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Number of hexadecimal digits of a formatted hash value. */
+#define HASH_STR_LEN 16
+
+
+/**
+ * Defines the state of an incremental 64-bit hash calculation (XXH64).
+ * The result is independent of how the data is split between the calls
+ * to hash_update().
+ */
+typedef struct {
+	uint64_t v[4];          /**< Accumulator lanes. */
+	uint64_t seed;          /**< Initial seed value. */
+	uint64_t total;         /**< Total number of bytes processed. */
+	unsigned char buf[32];  /**< Pending bytes of an incomplete stripe. */
+	size_t bufSize;         /**< Number of pending bytes in buf. */
+} tHash;
+
+
+void hash_init(tHash * h, const uint64_t seed);
+void hash_update(tHash * h, const void * data, const size_t size);
+uint64_t hash_final(const tHash * h);
+void hash_toStr(char * str, const uint64_t value);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __HASH_H__ */
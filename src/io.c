@@ -0,0 +1,481 @@
+/**
+ * @file io.c
+ * @author Daniel Starke
+ * @see io.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "io.h"
+#include "target.h"
+#include "thread.h"
+
+#ifdef PCF_IS_WIN
+# include <fcntl.h>
+# include <io.h>
+#endif /* PCF_IS_WIN */
+
+
+/** Initial buffer size for streams of unknown size. */
+#define IO_STREAM_INIT_SIZE 0x10000UL
+
+
+/** Defines a single read-ahead file slot. */
+typedef struct {
+	const TCHAR * file; /**< Input file path. */
+	char * data;        /**< File content (owned until taken by the consumer). */
+	size_t size;        /**< File content size in bytes. */
+	tIoStatus status;   /**< Read result. */
+} tIoSlot;
+
+
+/** Defines the input file read-ahead thread state. */
+struct tIoReader {
+	const TCHAR * const * files; /**< Input file paths in processing order. */
+	size_t count;                /**< Number of input files. */
+	size_t depth;                /**< Number of slots. */
+	size_t next;                 /**< Index of the next file taken by the consumer. */
+	tIoSlot * slots;             /**< File slots used in a round-robin manner. */
+	tSemaphore * freeSlots;      /**< Number of slots which can be filled. */
+	tSemaphore * usedSlots;      /**< Number of slots which can be taken. */
+	volatile int stop;           /**< Set to 1 to stop the thread early. */
+	tThread * thread;            /**< Read-ahead thread. */
+};
+
+
+/** Defines the output file write-behind thread state. */
+struct tIoWriter {
+	size_t depth;           /**< Number of job slots. */
+	size_t head;            /**< Index of the next job to write (writer thread only). */
+	size_t tail;            /**< Index of the next job to queue (producer only). */
+	tIoJob * jobs;          /**< Job slots used in a round-robin manner. */
+	tIoStatus * results;    /**< Write result per job slot (failed jobs keep their file path). */
+	tSemaphore * freeSlots; /**< Number of slots which can be filled. */
+	tSemaphore * usedSlots; /**< Number of queued jobs. */
+	tIoErrorFn onError;     /**< Error callback (called from the thread which queues the jobs). */
+	size_t failed;          /**< Number of failed jobs collected so far. */
+	tThread * thread;       /**< Write-behind thread. */
+};
+
+
+/**
+ * Checks whether the given file path refers to the standard input/output.
+ *
+ * @param[in] file - file path
+ * @return 1 for standard input/output, else 0
+ */
+int io_isStdio(const TCHAR * file) {
+	return (file != NULL && _tcscmp(file, IO_STDIO) == 0) ? 1 : 0;
+}
+
+
+/**
+ * Switches the given standard stream to binary mode to keep the line
+ * endings unchanged.
+ *
+ * @param[in,out] fp - standard stream
+ */
+static void setBinary(FILE * fp) {
+#ifdef PCF_IS_WIN
+	_setmode(_fileno(fp), _O_BINARY);
+#else /* not PCF_IS_WIN */
+	PCF_UNUSED(fp)
+#endif /* not PCF_IS_WIN */
+}
+
+
+/**
+ * Reads the given stream of unknown size until its end. The buffer grows
+ * as needed.
+ *
+ * @param[in,out] fp - input stream
+ * @param[out] data - allocated stream content (NULL for empty streams)
+ * @param[out] size - stream content size in bytes
+ * @return operation result
+ */
+static tIoStatus readStream(FILE * fp, char ** data, size_t * size) {
+	size_t capacity = 0;
+	*data = NULL;
+	*size = 0;
+	for (;;) {
+		if (*size >= capacity) {
+			const size_t newCapacity = (capacity > 0) ? (2 * capacity) : IO_STREAM_INIT_SIZE;
+			char * newData = (char *)realloc(*data, newCapacity);
+			if (newData == NULL) break;
+			*data = newData;
+			capacity = newCapacity;
+		}
+		const size_t n = fread(*data + *size, 1, capacity - *size, fp);
+		*size += n;
+		if (n == 0) {
+			if (ferror(fp) != 0) {
+				free(*data);
+				*data = NULL;
+				*size = 0;
+				return IO_ERR_READ;
+			}
+			if (*size < 1) {
+				free(*data);
+				*data = NULL;
+			}
+			return IO_OK;
+		}
+	}
+	free(*data);
+	*data = NULL;
+	*size = 0;
+	return IO_ERR_NO_MEM;
+}
+
+
+/**
+ * Reads the complete content of the given file. IO_STDIO reads the
+ * standard input. Streams which cannot be seeked (e.g. pipes) are read
+ * until their end.
+ *
+ * @param[in] file - input file path
+ * @param[out] data - allocated file content (NULL for empty files)
+ * @param[out] size - file content size in bytes
+ * @return operation result
+ */
+tIoStatus io_readFile(const TCHAR * file, char ** data, size_t * size) {
+	FILE * fp;
+	tIoStatus res;
+	*data = NULL;
+	*size = 0;
+	if (io_isStdio(file) != 0) {
+		setBinary(stdin);
+		return readStream(stdin, data, size);
+	}
+	fp = _tfopen(file, _T("rb"));
+	if (fp == NULL) return IO_ERR_OPEN;
+	/* get file size */
+	if (fseeko64(fp, 0, SEEK_END) != 0 || ftello64(fp) < 0) {
+		/* unknown size */
+		res = readStream(fp, data, size);
+		fclose(fp);
+		return res;
+	}
+	*size = (size_t)ftello64(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (*size < 1) {
+		fclose(fp);
+		return IO_OK;
+	}
+	*data = (char *)malloc(*size);
+	if (*data == NULL) {
+		fclose(fp);
+		return IO_ERR_NO_MEM;
+	}
+	if (fread(*data, *size, 1, fp) < 1) {
+		fclose(fp);
+		free(*data);
+		*data = NULL;
+		return IO_ERR_READ;
+	}
+	fclose(fp);
+	return IO_OK;
+}
+
+
+/**
+ * Creates the given file from the passed data segments. IO_STDIO writes
+ * to the standard output.
+ *
+ * @param[in] file - output file path
+ * @param[in] segments - data segments in output order
+ * @param[in] count - number of data segments
+ * @return operation result
+ */
+tIoStatus io_writeFile(const TCHAR * file, const tIoSegment * segments, const size_t count) {
+	const int isStdio = io_isStdio(file);
+	FILE * fp;
+	if (isStdio != 0) {
+		fp = stdout;
+		setBinary(fp);
+	} else {
+		fp = _tfopen(file, _T("wb"));
+		if (fp == NULL) return IO_ERR_CREATE;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (segments[i].size > 0 && fwrite(segments[i].data, segments[i].size, 1, fp) < 1) {
+			if (isStdio == 0) fclose(fp);
+			return IO_ERR_WRITE;
+		}
+	}
+	if (isStdio != 0) {
+		if (fflush(fp) != 0 || ferror(fp) != 0) return IO_ERR_WRITE;
+	} else if (fclose(fp) != 0) {
+		return IO_ERR_WRITE;
+	}
+	return IO_OK;
+}
+
+
+/**
+ * Releases all memory owned by the given write job.
+ *
+ * @param[in,out] job - write job
+ */
+void io_freeJob(tIoJob * job) {
+	if (job == NULL) return;
+	if (job->file != NULL) free(job->file);
+	if (job->segments != NULL) free(job->segments);
+	for (size_t i = 0; i < IO_MAX_BUFFERS; i++) {
+		if (job->buffers[i] != NULL) free(job->buffers[i]);
+	}
+	memset(job, 0, sizeof(*job));
+}
+
+
+/**
+ * Read-ahead thread function.
+ *
+ * @param[in,out] arg - reader state
+ */
+static void readerWorker(void * arg) {
+	tIoReader * reader = (tIoReader *)arg;
+	for (size_t i = 0; i < reader->count; i++) {
+		semaphore_wait(reader->freeSlots);
+		if (reader->stop != 0) break;
+		tIoSlot * slot = reader->slots + (i % reader->depth);
+		slot->file = reader->files[i];
+		slot->status = io_readFile(slot->file, &(slot->data), &(slot->size));
+		semaphore_post(reader->usedSlots);
+	}
+}
+
+
+/**
+ * Creates a thread which reads the given input files in advance. At most
+ * the given number of files is held in memory at once.
+ *
+ * @param[in] files - input file paths in processing order (needs to stay valid)
+ * @param[in] count - number of input files
+ * @param[in] depth - number of files to read in advance
+ * @return reader handle or NULL on error
+ */
+tIoReader * io_createReader(const TCHAR * const * files, const size_t count, const size_t depth) {
+	if (files == NULL || count < 1 || depth < 1) return NULL;
+	tIoReader * reader = (tIoReader *)calloc(1, sizeof(tIoReader));
+	if (reader == NULL) return NULL;
+	reader->files = files;
+	reader->count = count;
+	reader->depth = depth;
+	reader->slots = (tIoSlot *)calloc(depth, sizeof(tIoSlot));
+	reader->freeSlots = semaphore_create((unsigned int)depth);
+	reader->usedSlots = semaphore_create(0);
+	if (reader->slots == NULL || reader->freeSlots == NULL || reader->usedSlots == NULL) {
+		io_deleteReader(reader);
+		return NULL;
+	}
+	reader->thread = thread_create(readerWorker, reader);
+	if (reader->thread == NULL) {
+		io_deleteReader(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+
+/**
+ * Returns the content of the next input file. The file is read directly if
+ * it does not match the next read-ahead file or no reader is given.
+ *
+ * @param[in,out] reader - reader handle (may be NULL)
+ * @param[in] file - expected input file path
+ * @param[out] data - allocated file content (NULL for empty files)
+ * @param[out] size - file content size in bytes
+ * @return operation result
+ */
+tIoStatus io_nextFile(tIoReader * reader, const TCHAR * file, char ** data, size_t * size) {
+	if (reader == NULL || reader->thread == NULL || reader->next >= reader->count) {
+		return io_readFile(file, data, size);
+	}
+	semaphore_wait(reader->usedSlots);
+	tIoSlot * slot = reader->slots + (reader->next % reader->depth);
+	const tIoStatus status = slot->status;
+	const int isMatch = (_tcscmp(slot->file, file) == 0) ? 1 : 0;
+	*data = slot->data;
+	*size = slot->size;
+	slot->data = NULL;
+	reader->next++;
+	semaphore_post(reader->freeSlots);
+	if (isMatch == 0) {
+		if (*data != NULL) free(*data);
+		return io_readFile(file, data, size);
+	}
+	return status;
+}
+
+
+/**
+ * Stops the read-ahead thread and deletes the given reader.
+ *
+ * @param[in,out] reader - reader handle
+ */
+void io_deleteReader(tIoReader * reader) {
+	if (reader == NULL) return;
+	if (reader->thread != NULL) {
+		reader->stop = 1;
+		semaphore_post(reader->freeSlots); /* wake up if waiting */
+		thread_join(reader->thread);
+	}
+	for (size_t i = 0; reader->slots != NULL && i < reader->depth; i++) {
+		if (reader->slots[i].data != NULL) free(reader->slots[i].data);
+	}
+	if (reader->slots != NULL) free(reader->slots);
+	semaphore_delete(reader->freeSlots);
+	semaphore_delete(reader->usedSlots);
+	free(reader);
+}
+
+
+/**
+ * Write-behind thread function. A job without file path ends the thread.
+ *
+ * @param[in,out] arg - writer state
+ */
+static void writerWorker(void * arg) {
+	tIoWriter * writer = (tIoWriter *)arg;
+	for (;;) {
+		semaphore_wait(writer->usedSlots);
+		tIoJob * job = writer->jobs + (writer->head % writer->depth);
+		writer->head++;
+		if (job->file == NULL) break;
+		const tIoStatus status = io_writeFile(job->file, job->segments, job->count);
+		TCHAR * file = NULL;
+		if (status != IO_OK) {
+			/* the file path is kept to report the error once the slot is collected */
+			file = job->file;
+			job->file = NULL;
+		}
+		io_freeJob(job);
+		job->file = file;
+		writer->results[job - writer->jobs] = status;
+		semaphore_post(writer->freeSlots);
+	}
+}
+
+
+/**
+ * Collects the result of the finished job in the given slot. Errors are
+ * passed to the error callback. This is only called by the thread which
+ * queues the jobs, so that errors are reported in the same context as
+ * synchronous errors.
+ *
+ * @param[in,out] writer - writer handle
+ * @param[in] index - job slot index
+ */
+static void collectJob(tIoWriter * writer, const size_t index) {
+	tIoJob * job = writer->jobs + index;
+	if (writer->results[index] == IO_OK || job->file == NULL) return;
+	writer->failed++;
+	if (writer->onError != NULL) writer->onError(writer->results[index], job->file);
+	free(job->file);
+	job->file = NULL;
+	writer->results[index] = IO_OK;
+}
+
+
+/**
+ * Creates a thread which writes the queued output files in the background.
+ * Write errors are reported once the slot of the failed job is reused by
+ * io_queueWrite() or by io_deleteWriter().
+ *
+ * @param[in] depth - maximum number of queued jobs
+ * @param[in] onError - error callback called from the thread which queues the jobs (may be NULL)
+ * @return writer handle or NULL on error
+ */
+tIoWriter * io_createWriter(const size_t depth, tIoErrorFn onError) {
+	if (depth < 1) return NULL;
+	tIoWriter * writer = (tIoWriter *)calloc(1, sizeof(tIoWriter));
+	if (writer == NULL) return NULL;
+	/* one additional slot for the final empty job */
+	writer->depth = depth + 1;
+	writer->onError = onError;
+	writer->jobs = (tIoJob *)calloc(writer->depth, sizeof(tIoJob));
+	writer->results = (tIoStatus *)calloc(writer->depth, sizeof(tIoStatus));
+	writer->freeSlots = semaphore_create((unsigned int)depth);
+	writer->usedSlots = semaphore_create(0);
+	if (writer->jobs != NULL && writer->results != NULL && writer->freeSlots != NULL && writer->usedSlots != NULL) {
+		writer->thread = thread_create(writerWorker, writer);
+	}
+	if (writer->thread == NULL) {
+		if (writer->jobs != NULL) free(writer->jobs);
+		if (writer->results != NULL) free(writer->results);
+		semaphore_delete(writer->freeSlots);
+		semaphore_delete(writer->usedSlots);
+		free(writer);
+		return NULL;
+	}
+	return writer;
+}
+
+
+/**
+ * Queues the given write job. This blocks while the queue is full. The
+ * writer takes the ownership of all memory of the job. The job is cleared
+ * on return. The error of a previous job in the reused slot is reported
+ * first.
+ *
+ * @param[in,out] writer - writer handle
+ * @param[in,out] job - write job
+ */
+void io_queueWrite(tIoWriter * writer, tIoJob * job) {
+	semaphore_wait(writer->freeSlots);
+	collectJob(writer, writer->tail % writer->depth);
+	writer->jobs[writer->tail % writer->depth] = *job;
+	writer->tail++;
+	semaphore_post(writer->usedSlots);
+	memset(job, 0, sizeof(*job));
+}
+
+
+/**
+ * Writes all queued jobs, reports the remaining errors and deletes the
+ * given writer.
+ *
+ * @param[in,out] writer - writer handle
+ * @return number of failed jobs
+ */
+size_t io_deleteWriter(tIoWriter * writer) {
+	size_t res;
+	if (writer == NULL) return 0;
+	/*
+	 * The empty job ends the thread. Its slot may still hold the result of
+	 * the job queued depth jobs before, which has always finished because at
+	 * most depth - 1 jobs are outstanding.
+	 */
+	collectJob(writer, writer->tail % writer->depth);
+	memset(writer->jobs + (writer->tail % writer->depth), 0, sizeof(tIoJob));
+	writer->tail++;
+	semaphore_post(writer->usedSlots);
+	thread_join(writer->thread);
+	/* report in job order starting with the oldest slot */
+	for (size_t i = 0; i < writer->depth; i++) {
+		collectJob(writer, (writer->tail + i) % writer->depth);
+	}
+	res = writer->failed;
+	free(writer->jobs);
+	free(writer->results);
+	semaphore_delete(writer->freeSlots);
+	semaphore_delete(writer->usedSlots);
+	free(writer);
+	return res;
+}
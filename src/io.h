@@ -0,0 +1,96 @@
+/**
+ * @file io.h
+ * @author Daniel Starke
+ * @see io.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __IO_H__
+#define __IO_H__
+
+#include <stddef.h>
+#include "tchar.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** File path which refers to the standard input (reading) or standard output (writing). */
+#define IO_STDIO _T("-")
+
+/** Maximum number of memory buffers owned by a write job. */
+#define IO_MAX_BUFFERS 2
+
+
+/** Possible file operation results. */
+typedef enum {
+	IO_OK,         /**< success */
+	IO_ERR_NO_MEM, /**< memory allocation failed */
+	IO_ERR_OPEN,   /**< failed to open the input file */
+	IO_ERR_READ,   /**< failed to read from the input file */
+	IO_ERR_CREATE, /**< failed to create the output file */
+	IO_ERR_WRITE   /**< failed to write to the output file */
+} tIoStatus;
+
+
+/** Error callback type for asynchronous writes. Called from the thread which queues the jobs. */
+typedef void (* tIoErrorFn)(const tIoStatus status, const TCHAR * file);
+
+
+/** Defines a contiguous part of the output file data. */
+typedef struct {
+	const void * data; /**< Start of the data. */
+	size_t size;       /**< Size of the data in bytes. */
+} tIoSegment;
+
+
+/** Defines an output file write job. All pointed memory is owned by the job. */
+typedef struct {
+	TCHAR * file;                   /**< Output file path. */
+	tIoSegment * segments;          /**< Data segments in output order. */
+	size_t count;                   /**< Number of data segments. */
+	void * buffers[IO_MAX_BUFFERS]; /**< Memory referenced by the data segments (may be NULL). */
+} tIoJob;
+
+
+/** Opaque handle of an input file read-ahead thread. */
+typedef struct tIoReader tIoReader;
+
+
+/** Opaque handle of an output file write-behind thread. */
+typedef struct tIoWriter tIoWriter;
+
+
+int io_isStdio(const TCHAR * file);
+tIoStatus io_readFile(const TCHAR * file, char ** data, size_t * size);
+tIoStatus io_writeFile(const TCHAR * file, const tIoSegment * segments, const size_t count);
+void io_freeJob(tIoJob * job);
+tIoReader * io_createReader(const TCHAR * const * files, const size_t count, const size_t depth);
+tIoStatus io_nextFile(tIoReader * reader, const TCHAR * file, char ** data, size_t * size);
+void io_deleteReader(tIoReader * reader);
+tIoWriter * io_createWriter(const size_t depth, tIoErrorFn onError);
+void io_queueWrite(tIoWriter * writer, tIoJob * job);
+size_t io_deleteWriter(tIoWriter * writer);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __IO_H__ */
@@ -0,0 +1,678 @@
+/**
+ * @file pngenc.c
+ * @author Daniel Starke
+ * @see pngenc.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * The image data is split into parts of consecutive rows which are filtered
+ * and compressed by multiple threads. Each part is a raw deflate stream with
+ * the preceding 32 KiB of filtered data as preset dictionary. All but the
+ * last part end with a sync flush on a byte boundary. The concatenation of
+ * all parts is therefore a single valid deflate stream. The Adler-32
+ * checksums of the parts are combined into the checksum of the zlib stream.
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "pngenc.h"
+#include "simd.h"
+#include "target.h"
+#include "thread.h"
+
+
+/** Size of the deflate window in bytes. This is the maximum useful preset dictionary size. */
+#define PNGENC_WINDOW 32768
+
+/** Minimum size of the filtered image data in bytes per compressed part. */
+#define PNGENC_MIN_PART 0x40000
+
+/** Initial size of the compressed data buffer of a part in bytes. */
+#define PNGENC_INIT_OUT 0x10000
+
+/** Maximum data size of a single IDAT chunk in bytes. */
+#define PNGENC_MAX_IDAT 0x100000
+
+/** Number of filtered bytes between two checks against the best filter sum. */
+#define PNGENC_BLOCK 256
+
+/** Row filter type of the fast compression method (Up). */
+#define PNGENC_FAST_FILTER 2
+
+
+/** Defines the state of a single compressed part. */
+typedef struct {
+	struct tPngEnc * enc;       /**< Associated encoder. */
+	const unsigned char * rows; /**< First row passed to pngenc_addRows(). */
+	ptrdiff_t stride;           /**< Distance between two consecutive rows in bytes. */
+	size_t start;               /**< Index of the first row of this part relative to rows. */
+	size_t count;               /**< Number of rows in this part. */
+	int first;                  /**< Set to 1 if this part starts the zlib stream. */
+	int last;                   /**< Set to 1 if this part ends the zlib stream. */
+	unsigned char * buf;        /**< Filtered rows (preset dictionary or the next rows to compress). */
+	unsigned char * pix[2];     /**< Rows converted to the output pixel format. */
+	unsigned char * out;        /**< Compressed data. */
+	size_t outSize;             /**< Size of the compressed data in bytes. */
+	size_t outCapacity;         /**< Capacity of the compressed data buffer in bytes. */
+	unsigned long adler;        /**< Adler-32 checksum of the uncompressed data of this part. */
+	size_t inSize;              /**< Size of the uncompressed data of this part in bytes. */
+	int failed;                 /**< Set to 1 on error. */
+	tThread * thread;           /**< Compressing thread or NULL. */
+} tPngPart;
+
+
+/** Defines the PNG encoder state. */
+struct tPngEnc {
+	tPngEncFormat format;                 /**< Output pixel format. */
+	tPngEncMethod method;                 /**< Compression method. */
+	size_t bpp;                           /**< Output bytes per pixel. */
+	size_t width;                         /**< Image width in pixels. */
+	size_t height;                        /**< Image height in pixels. */
+	size_t rowBytes;                      /**< Size of a single output row in bytes. */
+	size_t rowCapacity;                   /**< Maximum row size of the allocated row buffers in bytes. */
+	size_t bufRows;                       /**< Number of filtered rows per part buffer (fills the preset dictionary). */
+	size_t rows;                          /**< Number of rows already added. */
+	size_t jobs;                          /**< Maximum number of parallel parts. */
+	unsigned long adler;                  /**< Adler-32 checksum of all uncompressed data so far. */
+	unsigned char * prev;                 /**< Last added row in output format (all zero before the first row). */
+	unsigned char window[PNGENC_WINDOW];  /**< Last filtered data of the previous call. */
+	size_t windowSize;                    /**< Number of valid bytes in window. */
+	unsigned char * data;                 /**< PNG file data. */
+	size_t size;                          /**< Size of the PNG file data in bytes. */
+	size_t capacity;                      /**< Capacity of the PNG file data buffer in bytes. */
+	tPngPart * parts;                     /**< Part states (one per job). */
+};
+
+
+/**
+ * Returns the absolute value of the given filter residual interpreted as
+ * signed byte.
+ *
+ * @param[in] x - filter residual
+ * @return absolute value
+ */
+static inline unsigned int absResidual(const int x) {
+	const unsigned int v = (unsigned int)x & 0xFF;
+	return (v < 128) ? v : 256 - v;
+}
+
+
+/**
+ * Paeth predictor as defined by the PNG specification.
+ *
+ * @param[in] a - left byte
+ * @param[in] b - upper byte
+ * @param[in] c - upper left byte
+ * @return predicted value
+ */
+static inline int paeth(const int a, const int b, const int c) {
+	const int p = a + b - c;
+	const int pa = abs(p - a);
+	const int pb = abs(p - b);
+	const int pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+
+/**
+ * Filters the first pixel of the given row. Its left neighbor is zero.
+ *
+ * @param[out] dst - filtered row (without the filter type byte)
+ * @param[in] type - PNG filter type (0 to 4)
+ * @param[in] row - image row
+ * @param[in] prev - previous image row
+ * @param[in] bpp - bytes per pixel
+ */
+static void filterFirst(unsigned char * dst, const int type, const unsigned char * row, const unsigned char * prev, const size_t bpp) {
+	for (size_t i = 0; i < bpp; i++) {
+		/* Sub equals None and Paeth equals Up without a left neighbor */
+		switch (type) {
+		case 2:
+		case 4:
+			dst[i] = (unsigned char)(row[i] - prev[i]);
+			break;
+		case 3:
+			dst[i] = (unsigned char)(row[i] - (prev[i] >> 1));
+			break;
+		default:
+			dst[i] = row[i];
+			break;
+		}
+	}
+}
+
+
+/**
+ * Filters the given byte range of an image row. The range needs to start
+ * after the first pixel. Each filter type has its own loop to allow the
+ * compiler to vectorize it.
+ *
+ * @param[out] dst - filtered row (without the filter type byte)
+ * @param[in] type - PNG filter type (0 to 4)
+ * @param[in] row - image row
+ * @param[in] prev - previous image row
+ * @param[in] bpp - bytes per pixel
+ * @param[in] start - first byte index (at least bpp)
+ * @param[in] end - byte index after the last byte
+ */
+static void filterRange(unsigned char * dst, const int type, const unsigned char * row, const unsigned char * prev, const size_t bpp, const size_t start, const size_t end) {
+	size_t i = start;
+	switch (type) {
+	case 1:
+		for (; i < end; i++) dst[i] = (unsigned char)(row[i] - row[i - bpp]);
+		break;
+	case 2:
+		for (; i < end; i++) dst[i] = (unsigned char)(row[i] - prev[i]);
+		break;
+	case 3:
+		for (; i < end; i++) dst[i] = (unsigned char)(row[i] - ((row[i - bpp] + prev[i]) >> 1));
+		break;
+	case 4:
+		for (; i < end; i++) dst[i] = (unsigned char)(row[i] - paeth(row[i - bpp], prev[i], prev[i - bpp]));
+		break;
+	default:
+		memcpy(dst + i, row + i, end - i);
+		break;
+	}
+}
+
+
+/**
+ * Filters the given image row. The default method chooses the filter type per
+ * row by the minimum sum of absolute residuals like libpng does by default.
+ * The sum of a filter type is computed in blocks and no longer once it
+ * exceeds the best one so far. The fast method always uses the same filter
+ * type.
+ *
+ * @param[in] enc - encoder
+ * @param[out] dst - filter type byte followed by the filtered row
+ * @param[in] row - image row
+ * @param[in] prev - previous image row (all zero for the first row)
+ */
+static void filterRow(const struct tPngEnc * enc, unsigned char * dst, const unsigned char * row, const unsigned char * prev) {
+	const size_t bpp = enc->bpp;
+	const size_t rowBytes = enc->rowBytes;
+	unsigned char * out = dst + 1;
+	unsigned long bestSum = ULONG_MAX;
+	int best = PNGENC_FAST_FILTER;
+	int type = 0;
+	for (; enc->method == PNGENC_DEFAULT && type < 5 && bestSum > 0; type++) {
+		unsigned long sum = 0;
+		size_t i = bpp;
+		filterFirst(out, type, row, prev, bpp);
+		for (size_t j = 0; j < bpp; j++) sum += absResidual(out[j]);
+		while (i < rowBytes && sum < bestSum) {
+			const size_t end = PCF_MIN(i + PNGENC_BLOCK, rowBytes);
+			filterRange(out, type, row, prev, bpp, i, end);
+			sum += (unsigned long)simd_sumAbsSigned(out + i, end - i);
+			i = end;
+		}
+		if (sum < bestSum) {
+			bestSum = sum;
+			best = type;
+		}
+	}
+	dst[0] = (unsigned char)best;
+	if (best != (type - 1)) {
+		/* the output buffer holds the complete row of the last tried filter type only */
+		filterFirst(out, best, row, prev, bpp);
+		filterRange(out, best, row, prev, bpp, bpp, rowBytes);
+	}
+}
+
+
+/**
+ * Returns the given RGBA image row in the output pixel format of the passed
+ * encoder.
+ *
+ * @param[in] enc - encoder
+ * @param[out] buf - buffer for the converted row
+ * @param[in] rgba - RGBA image row
+ * @return converted row (buf or rgba)
+ */
+static const unsigned char * getPixels(const struct tPngEnc * enc, unsigned char * buf, const unsigned char * rgba) {
+	switch (enc->format) {
+	case PNGENC_RGB:
+		for (size_t x = 0; x < enc->width; x++) {
+			buf[(3 * x) + 0] = rgba[(4 * x) + 0];
+			buf[(3 * x) + 1] = rgba[(4 * x) + 1];
+			buf[(3 * x) + 2] = rgba[(4 * x) + 2];
+		}
+		return buf;
+	case PNGENC_GRAY:
+		for (size_t x = 0; x < enc->width; x++) buf[x] = rgba[4 * x];
+		return buf;
+	default:
+		return rgba;
+	}
+}
+
+
+/**
+ * Returns the image row with the given index of the passed part.
+ *
+ * @param[in] part - part state
+ * @param[in] index - row index relative to the first row passed to pngenc_addRows()
+ * @return RGBA image row
+ */
+static const unsigned char * getRow(const tPngPart * part, const size_t index) {
+	return part->rows + ((ptrdiff_t)index * part->stride);
+}
+
+
+/**
+ * Filters the given range of rows into the buffer of the passed part.
+ *
+ * @param[in,out] part - part state
+ * @param[in] index - first row index relative to the first row passed to pngenc_addRows()
+ * @param[in] count - number of rows (at most bufRows)
+ * @return size of the filtered data in bytes
+ */
+static size_t filterRows(tPngPart * part, const size_t index, const size_t count) {
+	const tPngEnc * enc = part->enc;
+	const size_t lineSize = enc->rowBytes + 1;
+	const unsigned char * prev = (index > 0) ? getPixels(enc, part->pix[0], getRow(part, index - 1)) : enc->prev;
+	for (size_t i = 0; i < count; i++) {
+		/* the converted previous row stays in the other buffer */
+		const unsigned char * row = getPixels(enc, part->pix[(i + 1) & 1], getRow(part, index + i));
+		filterRow(enc, part->buf + (i * lineSize), row, prev);
+		prev = row;
+	}
+	return count * lineSize;
+}
+
+
+/**
+ * Ensures that the compressed data buffer of the given part can take at
+ * least the passed number of additional bytes.
+ *
+ * @param[in,out] part - part state
+ * @param[in] size - number of additional bytes
+ * @return 1 on success, 0 on allocation error
+ */
+static int reservePart(tPngPart * part, const size_t size) {
+	size_t newCapacity = (part->outCapacity > 0) ? part->outCapacity : PNGENC_INIT_OUT;
+	unsigned char * newOut;
+	if ((part->outSize + size) <= part->outCapacity) return 1;
+	while (newCapacity < (part->outSize + size)) newCapacity *= 2;
+	newOut = (unsigned char *)realloc(part->out, newCapacity);
+	if (newOut == NULL) return 0;
+	part->out = newOut;
+	part->outCapacity = newCapacity;
+	return 1;
+}
+
+
+/**
+ * Passes the pending input of the given stream to the deflate function until
+ * all input was consumed.
+ *
+ * @param[in,out] part - part state which receives the compressed data
+ * @param[in,out] strm - deflate stream
+ * @param[in] flush - zlib flush mode
+ * @return 1 on success, 0 on error
+ */
+static int deflatePart(tPngPart * part, z_stream * strm, const int flush) {
+	for (;;) {
+		int res;
+		if (part->outSize >= part->outCapacity && reservePart(part, 1) != 1) return 0;
+		strm->next_out = part->out + part->outSize;
+		strm->avail_out = (uInt)PCF_MIN(part->outCapacity - part->outSize, (size_t)0x40000000);
+		res = deflate(strm, flush);
+		part->outSize = (size_t)(strm->next_out - part->out);
+		if (res == Z_STREAM_ERROR) return 0;
+		if (flush == Z_FINISH) {
+			if (res == Z_STREAM_END) return 1;
+		} else if (strm->avail_in == 0 && strm->avail_out > 0) {
+			return 1;
+		}
+	}
+}
+
+
+/**
+ * Filters and compresses the rows of the given part. This is the thread
+ * function of all but the first part. The fast method uses the run-length
+ * only deflate strategy of zlib, which finds the long runs of equal bytes of
+ * filtered line art at a fraction of the default search cost.
+ *
+ * @param[in,out] arg - part state
+ */
+static void compressPart(void * arg) {
+	tPngPart * part = (tPngPart *)arg;
+	const tPngEnc * enc = part->enc;
+	const int isFast = (enc->method == PNGENC_FAST) ? 1 : 0;
+	z_stream strm;
+	part->failed = 1;
+	part->outSize = 0;
+	part->inSize = 0;
+	part->adler = adler32(0L, Z_NULL, 0);
+	memset(&strm, 0, sizeof(strm));
+	if (deflateInit2(&strm, (isFast != 0) ? 1 : 6, Z_DEFLATED, -15, 8, (isFast != 0) ? Z_RLE : Z_FILTERED) != Z_OK) return;
+	if (part->first != 0) {
+		/* zlib header for a 32 KiB window with the compression level hint and check bits */
+		unsigned int header = (0x78 << 8) | ((isFast != 0) ? 0x00 : 0x80);
+		header += (31 - (header % 31)) % 31;
+		if (reservePart(part, 2) != 1) goto onError;
+		part->out[0] = (unsigned char)(header >> 8);
+		part->out[1] = (unsigned char)header;
+		part->outSize = 2;
+	}
+	/* the preceding filtered data keeps the compression ratio close to that of a single stream */
+	if (part->start > 0) {
+		const size_t first = (part->start > enc->bufRows) ? (part->start - enc->bufRows) : 0;
+		const size_t dictSize = filterRows(part, first, part->start - first);
+		const size_t useSize = PCF_MIN(dictSize, (size_t)PNGENC_WINDOW);
+		if (deflateSetDictionary(&strm, part->buf + dictSize - useSize, (uInt)useSize) != Z_OK) goto onError;
+	} else if (enc->windowSize > 0) {
+		if (deflateSetDictionary(&strm, enc->window, (uInt)enc->windowSize) != Z_OK) goto onError;
+	}
+	for (size_t i = part->start, end = part->start + part->count; i < end; ) {
+		const size_t n = PCF_MIN(end - i, enc->bufRows);
+		const size_t size = filterRows(part, i, n);
+		i += n;
+		part->adler = adler32(part->adler, part->buf, (uInt)size);
+		part->inSize += size;
+		strm.next_in = part->buf;
+		strm.avail_in = (uInt)size;
+		/* a sync flush ends the part on a byte boundary without marking the last block */
+		if (deflatePart(part, &strm, (i < end) ? Z_NO_FLUSH : ((part->last != 0) ? Z_FINISH : Z_SYNC_FLUSH)) != 1) goto onError;
+	}
+	part->failed = 0;
+onError:
+	deflateEnd(&strm);
+}
+
+
+/**
+ * Ensures that the PNG file data buffer can take at least the passed number
+ * of additional bytes.
+ *
+ * @param[in,out] enc - encoder
+ * @param[in] size - number of additional bytes
+ * @return 1 on success, 0 on allocation error
+ */
+static int reserve(tPngEnc * enc, const size_t size) {
+	size_t newCapacity = (enc->capacity > 0) ? enc->capacity : PNGENC_INIT_OUT;
+	unsigned char * newData;
+	if ((enc->size + size) <= enc->capacity) return 1;
+	while (newCapacity < (enc->size + size)) newCapacity *= 2;
+	newData = (unsigned char *)realloc(enc->data, newCapacity);
+	if (newData == NULL) return 0;
+	enc->data = newData;
+	enc->capacity = newCapacity;
+	return 1;
+}
+
+
+/**
+ * Writes the given value in big-endian byte order to the passed buffer.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] value - value to write
+ */
+static void putU32(unsigned char * dst, const unsigned long value) {
+	dst[0] = (unsigned char)(value >> 24);
+	dst[1] = (unsigned char)(value >> 16);
+	dst[2] = (unsigned char)(value >> 8);
+	dst[3] = (unsigned char)value;
+}
+
+
+/**
+ * Appends a chunk to the PNG file data.
+ *
+ * @param[in,out] enc - encoder
+ * @param[in] type - chunk type (4 characters)
+ * @param[in] data - chunk data
+ * @param[in] size - chunk data size in bytes
+ * @return 1 on success, 0 on allocation error
+ */
+static int addChunk(tPngEnc * enc, const char * type, const unsigned char * data, const size_t size) {
+	unsigned long crc;
+	if (reserve(enc, size + 12) != 1) return 0;
+	putU32(enc->data + enc->size, (unsigned long)size);
+	memcpy(enc->data + enc->size + 4, type, 4);
+	if (size > 0) memcpy(enc->data + enc->size + 8, data, size);
+	crc = crc32(0L, enc->data + enc->size + 4, (uInt)(size + 4));
+	putU32(enc->data + enc->size + 8 + size, crc);
+	enc->size += size + 12;
+	return 1;
+}
+
+
+/**
+ * Resizes the given buffer.
+ *
+ * @param[in,out] buf - buffer to resize
+ * @param[in] size - new size in bytes
+ * @return 1 on success, 0 on allocation error
+ */
+static int resizeBuffer(unsigned char ** buf, const size_t size) {
+	unsigned char * newBuf = (unsigned char *)realloc(*buf, size);
+	if (newBuf == NULL) return 0;
+	*buf = newBuf;
+	return 1;
+}
+
+
+/**
+ * Creates a new PNG encoder. The encoder and its buffers are reused for all
+ * images started with pngenc_start().
+ *
+ * @param[in] jobs - maximum number of threads used to compress the image data
+ * @return encoder or NULL on allocation error
+ */
+tPngEnc * pngenc_create(const size_t jobs) {
+	if (jobs < 1 || jobs > PNGENC_MAX_JOBS) return NULL;
+	tPngEnc * enc = (tPngEnc *)calloc(1, sizeof(tPngEnc));
+	if (enc == NULL) return NULL;
+	enc->jobs = jobs;
+	enc->parts = (tPngPart *)calloc(jobs, sizeof(tPngPart));
+	if (enc->parts == NULL) {
+		free(enc);
+		return NULL;
+	}
+	for (size_t i = 0; i < jobs; i++) {
+		enc->parts[i].enc = enc;
+	}
+	return enc;
+}
+
+
+/**
+ * Deletes the given PNG encoder.
+ *
+ * @param[in,out] enc - encoder
+ */
+void pngenc_delete(tPngEnc * enc) {
+	if (enc == NULL) return;
+	for (size_t i = 0; i < enc->jobs; i++) {
+		tPngPart * part = enc->parts + i;
+		if (part->buf != NULL) free(part->buf);
+		if (part->pix[0] != NULL) free(part->pix[0]);
+		if (part->pix[1] != NULL) free(part->pix[1]);
+		if (part->out != NULL) free(part->out);
+	}
+	free(enc->parts);
+	if (enc->prev != NULL) free(enc->prev);
+	if (enc->data != NULL) free(enc->data);
+	free(enc);
+}
+
+
+/**
+ * Starts a new PNG image and writes the PNG signature and image header.
+ * The row buffers are only reallocated if the image rows are larger than
+ * those of all previous images.
+ *
+ * @param[in,out] enc - encoder
+ * @param[in] width - image width in pixels
+ * @param[in] height - image height in pixels
+ * @param[in] format - output pixel format
+ * @param[in] method - compression method
+ * @return 1 on success, 0 on error
+ */
+int pngenc_start(tPngEnc * enc, const int width, const int height, const tPngEncFormat format, const tPngEncMethod method) {
+	static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	static const unsigned char colorType[3] = {6, 2, 0};
+	static const size_t bytesPerPixel[3] = {4, 3, 1};
+	unsigned char ihdr[13];
+	if (width < 1 || height < 1 || (int)format < 0 || (int)format > (int)PNGENC_GRAY) return 0;
+	enc->format = format;
+	enc->method = method;
+	enc->bpp = bytesPerPixel[format];
+	enc->width = (size_t)width;
+	enc->height = (size_t)height;
+	enc->rowBytes = enc->width * enc->bpp;
+	enc->bufRows = (PNGENC_WINDOW + enc->rowBytes) / (enc->rowBytes + 1);
+	enc->rows = 0;
+	enc->adler = adler32(0L, Z_NULL, 0);
+	enc->windowSize = 0;
+	enc->size = 0;
+	if (enc->rowBytes > enc->rowCapacity) {
+		/* bufRows rows take at most PNGENC_WINDOW bytes plus one row */
+		enc->rowCapacity = 0;
+		if (resizeBuffer(&(enc->prev), enc->rowBytes) != 1) return 0;
+		for (size_t i = 0; i < enc->jobs; i++) {
+			tPngPart * part = enc->parts + i;
+			if (resizeBuffer(&(part->buf), PNGENC_WINDOW + enc->rowBytes + 1) != 1) return 0;
+			if (resizeBuffer(part->pix, enc->rowBytes) != 1) return 0;
+			if (resizeBuffer(part->pix + 1, enc->rowBytes) != 1) return 0;
+		}
+		enc->rowCapacity = enc->rowBytes;
+	}
+	memset(enc->prev, 0, enc->rowBytes);
+	if (reserve(enc, sizeof(signature)) != 1) return 0;
+	memcpy(enc->data, signature, sizeof(signature));
+	enc->size = sizeof(signature);
+	putU32(ihdr, (unsigned long)width);
+	putU32(ihdr + 4, (unsigned long)height);
+	ihdr[8] = 8;  /* bit depth */
+	ihdr[9] = colorType[format];
+	ihdr[10] = 0; /* deflate compression */
+	ihdr[11] = 0; /* adaptive filtering */
+	ihdr[12] = 0; /* no interlace */
+	return addChunk(enc, "IHDR", ihdr, sizeof(ihdr));
+}
+
+
+/**
+ * Filters, compresses and appends the given opaque RGBA image rows. Large
+ * row ranges are split into parts which are compressed in parallel.
+ *
+ * @param[in,out] enc - encoder
+ * @param[in] rows - first image row in PNG order
+ * @param[in] stride - distance between two consecutive rows in bytes (may be negative)
+ * @param[in] count - number of rows
+ * @return 1 on success, 0 on error
+ */
+int pngenc_addRows(tPngEnc * enc, const unsigned char * rows, const ptrdiff_t stride, const size_t count) {
+	const size_t lineSize = enc->rowBytes + 1;
+	size_t parts;
+	int res = 1;
+	if (count == 0 || count > (enc->height - enc->rows)) return 0;
+	parts = PCF_MIN(PCF_MIN(enc->jobs, (count * lineSize) / PNGENC_MIN_PART), count);
+	if (parts < 1) parts = 1;
+	for (size_t i = 0; i < parts; i++) {
+		tPngPart * part = enc->parts + i;
+		part->rows = rows;
+		part->stride = stride;
+		part->start = (count * i) / parts;
+		part->count = ((count * (i + 1)) / parts) - part->start;
+		part->first = (enc->rows == 0 && i == 0) ? 1 : 0;
+		part->last = ((i + 1) >= parts && (enc->rows + count) >= enc->height) ? 1 : 0;
+		part->thread = (i > 0) ? thread_create(compressPart, part) : NULL;
+	}
+	compressPart(enc->parts);
+	for (size_t i = 1; i < parts; i++) {
+		tPngPart * part = enc->parts + i;
+		if (part->thread != NULL) {
+			thread_join(part->thread);
+			part->thread = NULL;
+		} else {
+			/* failed to create the thread */
+			compressPart(part);
+		}
+	}
+	/* append the parts in order */
+	for (size_t i = 0; i < parts && res == 1; i++) {
+		tPngPart * part = enc->parts + i;
+		if (part->failed != 0) {
+			res = 0;
+			break;
+		}
+		enc->adler = adler32_combine(enc->adler, part->adler, (z_off_t)part->inSize);
+		if (part->last != 0) {
+			if (reservePart(part, 4) != 1) {
+				res = 0;
+				break;
+			}
+			putU32(part->out + part->outSize, enc->adler);
+			part->outSize += 4;
+		}
+		for (size_t offset = 0; offset < part->outSize; offset += PNGENC_MAX_IDAT) {
+			if (addChunk(enc, "IDAT", part->out + offset, PCF_MIN(part->outSize - offset, (size_t)PNGENC_MAX_IDAT)) != 1) {
+				res = 0;
+				break;
+			}
+		}
+	}
+	if (res != 1) return res;
+	if ((enc->rows + count) < enc->height) {
+		/* keep the last filtered data as preset dictionary for the next call */
+		tPngPart * part = enc->parts;
+		const size_t n = PCF_MIN(count, enc->bufRows);
+		const size_t size = filterRows(part, count - n, n);
+		const unsigned char * last;
+		if (size >= PNGENC_WINDOW) {
+			memcpy(enc->window, part->buf + size - PNGENC_WINDOW, PNGENC_WINDOW);
+			enc->windowSize = PNGENC_WINDOW;
+		} else {
+			const size_t keep = PCF_MIN(enc->windowSize, PNGENC_WINDOW - size);
+			memmove(enc->window, enc->window + enc->windowSize - keep, keep);
+			memcpy(enc->window + keep, part->buf, size);
+			enc->windowSize = keep + size;
+		}
+		last = getPixels(enc, enc->prev, getRow(part, count - 1));
+		if (last != enc->prev) memcpy(enc->prev, last, enc->rowBytes);
+	}
+	enc->rows += count;
+	return 1;
+}
+
+
+/**
+ * Completes the PNG file data after all rows were added and passes its
+ * ownership to the caller.
+ *
+ * @param[in,out] enc - encoder
+ * @param[out] size - size of the returned data in bytes
+ * @return PNG file data (to be freed with free()) or NULL on error
+ */
+unsigned char * pngenc_finish(tPngEnc * enc, size_t * size) {
+	unsigned char * data;
+	if (enc->rows < enc->height || addChunk(enc, "IEND", NULL, 0) != 1) return NULL;
+	data = enc->data;
+	*size = enc->size;
+	enc->data = NULL;
+	enc->size = 0;
+	enc->capacity = 0;
+	return data;
+}
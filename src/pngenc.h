@@ -0,0 +1,67 @@
+/**
+ * @file pngenc.h
+ * @author Daniel Starke
+ * @see pngenc.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __PNGENC_H__
+#define __PNGENC_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Maximum number of threads used to compress the image data. */
+#define PNGENC_MAX_JOBS 64
+
+
+/** Possible PNG pixel formats. The input rows are always opaque 8-bit RGBA. */
+typedef enum {
+	PNGENC_RGBA, /**< 8-bit RGBA */
+	PNGENC_RGB,  /**< 8-bit RGB (alpha is dropped) */
+	PNGENC_GRAY  /**< 8-bit grayscale (the red channel is used) */
+} tPngEncFormat;
+
+
+/** Possible compression methods. */
+typedef enum {
+	PNGENC_DEFAULT, /**< adaptive row filters and zlib level 6 (like libpng) */
+	PNGENC_FAST     /**< fixed row filter and run-length only deflate */
+} tPngEncMethod;
+
+
+/** Opaque handle of a PNG encoder for 8-bit images. */
+typedef struct tPngEnc tPngEnc;
+
+
+tPngEnc * pngenc_create(const size_t jobs);
+void pngenc_delete(tPngEnc * enc);
+int pngenc_start(tPngEnc * enc, const int width, const int height, const tPngEncFormat format, const tPngEncMethod method);
+int pngenc_addRows(tPngEnc * enc, const unsigned char * rows, const ptrdiff_t stride, const size_t count);
+unsigned char * pngenc_finish(tPngEnc * enc, size_t * size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __PNGENC_H__ */
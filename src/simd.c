@@ -0,0 +1,609 @@
+/**
+ * @file simd.c
+ * @author Daniel Starke
+ * @see simd.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "simd.h"
+#include "target.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+/** Defined if SSE2 intrinsics can be used. */
+# define SIMD_HAS_SSE2 1
+#endif
+
+#if defined(SIMD_HAS_SSE2) && (defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ * 100) + __GNUC_MINOR__) >= 409))
+# include <immintrin.h>
+/** Defined if AVX2 intrinsics can be used in functions marked with SIMD_TARGET_AVX2. */
+# define SIMD_HAS_AVX2 1
+/** Enables AVX2 code generation for a single function. */
+# define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(SIMD_HAS_SSE2) && defined(_MSC_VER) && _MSC_VER >= 1700
+# include <immintrin.h>
+# define SIMD_HAS_AVX2 1
+# define SIMD_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+# include <intrin.h>
+#endif
+
+
+/** Defines the kernel functions for one instruction set. */
+typedef struct {
+	void (* colorize)(unsigned char * img, const unsigned char * mask, const size_t count, const unsigned int bg, const unsigned int fg);
+	void (* downsample2x)(unsigned char * dst, const unsigned char * src, const size_t width, const size_t height);
+	size_t (* countChar)(const char * data, const size_t size, const char ch);
+	size_t (* sumAbsSigned)(const unsigned char * data, const size_t size);
+	tSimdAddWeight addWeight;
+	tSimdBlendMask blendMask;
+} tSimdKernels;
+
+
+/**
+ * Divides the given value by 255 with correct rounding.
+ * The input range is 0..65025.
+ *
+ * @param[in] x - value to divide
+ * @return x / 255
+ */
+static inline unsigned int div255(const unsigned int x) {
+	return ((x + 128) * 257) >> 16;
+}
+
+
+/**
+ * Divides the given value by 255 like nanosvgrast does.
+ * The input range is 0..65025.
+ *
+ * @param[in] x - value to divide
+ * @return x / 255
+ */
+static inline unsigned int div255Rast(const unsigned int x) {
+	return ((x + 1) * 257) >> 16;
+}
+
+
+/* generic C kernels (also used for the remaining elements of the vectorized kernels) */
+
+
+static void colorizeC(unsigned char * img, const unsigned char * mask, const size_t count, const unsigned int bg, const unsigned int fg) {
+	unsigned char * pixel = img;
+	for (size_t i = 0; i < count; i++, pixel += 4) {
+		const unsigned int a = mask[i];
+		const unsigned int ia = 255 - a;
+		pixel[0] = (unsigned char)div255(((bg & 0xFF) * ia) + ((fg & 0xFF) * a));
+		pixel[1] = (unsigned char)div255((((bg >> 8) & 0xFF) * ia) + (((fg >> 8) & 0xFF) * a));
+		pixel[2] = (unsigned char)div255((((bg >> 16) & 0xFF) * ia) + (((fg >> 16) & 0xFF) * a));
+		pixel[3] = 255; /* opaque */
+	}
+}
+
+
+static void downsampleRowC(unsigned char * dst, const unsigned char * row0, const unsigned char * row1, const size_t width) {
+	for (size_t x = 0; (x + 1) < width; x += 2) {
+		for (size_t i = 0; i < 4; i++, dst++) {
+			const unsigned int sum = (unsigned int)row0[(4 * x) + i] + row0[(4 * x) + 4 + i] + row1[(4 * x) + i] + row1[(4 * x) + 4 + i];
+			*dst = (unsigned char)((sum + 2) >> 2);
+		}
+	}
+}
+
+
+static void downsample2xC(unsigned char * dst, const unsigned char * src, const size_t width, const size_t height) {
+	const size_t stride = 4 * width;
+	for (size_t y = 0; (y + 1) < height; y += 2, dst += 4 * (width / 2)) {
+		downsampleRowC(dst, src + (y * stride), src + ((y + 1) * stride), width);
+	}
+}
+
+
+static size_t countCharC(const char * data, const size_t size, const char ch) {
+	size_t res = 0;
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] == ch) res++;
+	}
+	return res;
+}
+
+
+static size_t sumAbsSignedC(const unsigned char * data, const size_t size) {
+	size_t res = 0;
+	for (size_t i = 0; i < size; i++) {
+		res += (data[i] < 128) ? data[i] : (256 - data[i]);
+	}
+	return res;
+}
+
+
+static void addWeightC(unsigned char * cover, const size_t count, const unsigned int weight) {
+	for (size_t i = 0; i < count; i++) {
+		cover[i] = (unsigned char)(cover[i] + weight);
+	}
+}
+
+
+static void blendMaskC(unsigned char * mask, const unsigned char * cover, const size_t count, const unsigned int alpha) {
+	for (size_t i = 0; i < count; i++) {
+		const unsigned int a = div255Rast(cover[i] * alpha);
+		mask[i] = (unsigned char)(a + div255Rast((255 - a) * mask[i]));
+	}
+}
+
+
+#ifdef SIMD_HAS_SSE2
+/* SSE2 kernels */
+
+
+static void colorizeSse2(unsigned char * img, const unsigned char * mask, const size_t count, const unsigned int bg, const unsigned int fg) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i c257 = _mm_set1_epi16(257);
+	/* both alpha lanes are 255 to get an opaque result */
+	const __m128i bg16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)(bg | 0xFF000000)), zero);
+	const __m128i fg16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)(fg | 0xFF000000)), zero);
+	size_t i = 0;
+	for (; (i + 8) <= count; i += 8) {
+		/* load all mask values before the first store as they may overlap */
+		const __m128i m = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(mask + i)), zero);
+		/* broadcast each mask value to the four lanes of its pixel */
+		const __m128i m03 = _mm_unpacklo_epi16(m, m);
+		const __m128i m47 = _mm_unpackhi_epi16(m, m);
+		__m128i px[4];
+		px[0] = _mm_unpacklo_epi32(m03, m03);
+		px[1] = _mm_unpackhi_epi32(m03, m03);
+		px[2] = _mm_unpacklo_epi32(m47, m47);
+		px[3] = _mm_unpackhi_epi32(m47, m47);
+		for (int k = 0; k < 4; k++) {
+			/* div255(background * (255 - mask) + foreground * mask) */
+			const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(c255, px[k]), bg16), _mm_mullo_epi16(px[k], fg16));
+			px[k] = _mm_mulhi_epu16(_mm_add_epi16(sum, c128), c257);
+		}
+		_mm_storeu_si128((__m128i *)(img + (4 * i)), _mm_packus_epi16(px[0], px[1]));
+		_mm_storeu_si128((__m128i *)(img + (4 * i) + 16), _mm_packus_epi16(px[2], px[3]));
+	}
+	colorizeC(img + (4 * i), mask + i, count - i, bg, fg);
+}
+
+
+static void downsample2xSse2(unsigned char * dst, const unsigned char * src, const size_t width, const size_t height) {
+	const size_t stride = 4 * width;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c2 = _mm_set1_epi16(2);
+	for (size_t y = 0; (y + 1) < height; y += 2) {
+		const unsigned char * row0 = src + (y * stride);
+		const unsigned char * row1 = row0 + stride;
+		size_t x = 0;
+		for (; (x + 4) <= width; x += 4, dst += 8) {
+			const __m128i a = _mm_loadu_si128((const __m128i *)(row0 + (4 * x)));
+			const __m128i b = _mm_loadu_si128((const __m128i *)(row1 + (4 * x)));
+			/* vertical sums of pixel 0/1 and 2/3 */
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			/* horizontal sums */
+			lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+			lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), c2), 2);
+			_mm_storel_epi64((__m128i *)dst, _mm_packus_epi16(lo, lo));
+		}
+		downsampleRowC(dst, row0 + (4 * x), row1 + (4 * x), width - x);
+		dst += 4 * ((width - x) / 2);
+	}
+}
+
+
+/**
+ * Returns the sum of the two 64-bit lanes of the given vector.
+ *
+ * @param[in] v - vector to sum up
+ * @return sum of both lanes
+ */
+static inline size_t sumLanesSse2(const __m128i v) {
+	uint64_t lo, hi;
+	/* _mm_cvtsi128_si64() is not available on 32-bit targets */
+	_mm_storel_epi64((__m128i *)&lo, v);
+	_mm_storel_epi64((__m128i *)&hi, _mm_unpackhi_epi64(v, v));
+	return (size_t)(lo + hi);
+}
+
+
+static size_t countCharSse2(const char * data, const size_t size, const char ch) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i pattern = _mm_set1_epi8(ch);
+	size_t res = 0;
+	size_t i = 0;
+	while ((i + 16) <= size) {
+		/* per byte lane counters; a block of at most 255 vectors cannot overflow them */
+		__m128i counts = zero;
+		for (size_t n = 0; n < 255 && (i + 16) <= size; n++, i += 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+			counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(v, pattern));
+		}
+		/* horizontal sum of the lane counters */
+		res += sumLanesSse2(_mm_sad_epu8(counts, zero));
+	}
+	return res + countCharC(data + i, size - i, ch);
+}
+
+
+static size_t sumAbsSignedSse2(const unsigned char * data, const size_t size) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sums = zero;
+	size_t i = 0;
+	for (; (i + 16) <= size; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		/* min(x, 256 - x) is the absolute value of the signed byte x */
+		sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero));
+	}
+	return sumLanesSse2(sums) + sumAbsSignedC(data + i, size - i);
+}
+
+
+static void addWeightSse2(unsigned char * cover, const size_t count, const unsigned int weight) {
+	const __m128i w = _mm_set1_epi8((char)weight);
+	size_t i = 0;
+	for (; (i + 16) <= count; i += 16) {
+		__m128i * p = (__m128i *)(cover + i);
+		_mm_storeu_si128(p, _mm_add_epi8(_mm_loadu_si128(p), w));
+	}
+	addWeightC(cover + i, count - i, weight);
+}
+
+
+static void blendMaskSse2(unsigned char * mask, const unsigned char * cover, const size_t count, const unsigned int alpha) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c1 = _mm_set1_epi16(1);
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i c257 = _mm_set1_epi16(257);
+	const __m128i ca = _mm_set1_epi16((short)alpha);
+	size_t i = 0;
+	for (; (i + 16) <= count; i += 16) {
+		const __m128i c = _mm_loadu_si128((const __m128i *)(cover + i));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(mask + i));
+		/* a = div255(cover * alpha); a + div255((255 - a) * mask) */
+		const __m128i alo = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), ca), c1), c257);
+		const __m128i ahi = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), ca), c1), c257);
+		const __m128i dlo = _mm_mullo_epi16(_mm_sub_epi16(c255, alo), _mm_unpacklo_epi8(d, zero));
+		const __m128i dhi = _mm_mullo_epi16(_mm_sub_epi16(c255, ahi), _mm_unpackhi_epi8(d, zero));
+		const __m128i lo = _mm_add_epi16(alo, _mm_mulhi_epu16(_mm_add_epi16(dlo, c1), c257));
+		const __m128i hi = _mm_add_epi16(ahi, _mm_mulhi_epu16(_mm_add_epi16(dhi, c1), c257));
+		_mm_storeu_si128((__m128i *)(mask + i), _mm_packus_epi16(lo, hi));
+	}
+	blendMaskC(mask + i, cover + i, count - i, alpha);
+}
+#endif /* SIMD_HAS_SSE2 */
+
+
+#ifdef SIMD_HAS_AVX2
+/* AVX2 kernels (the 128-bit lanes are processed independently like in the SSE2 kernels) */
+
+
+/**
+ * Returns the sum of the 64-bit lanes of the given vector.
+ *
+ * @param[in] v - vector to sum up
+ * @return sum of all lanes
+ */
+static SIMD_TARGET_AVX2 size_t sumLanesAvx2(const __m256i v) {
+	return sumLanesSse2(_mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+
+static SIMD_TARGET_AVX2 void colorizeAvx2(unsigned char * img, const unsigned char * mask, const size_t count, const unsigned int bg, const unsigned int fg) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c128 = _mm256_set1_epi16(128);
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const __m256i c257 = _mm256_set1_epi16(257);
+	/* replicates mask value 0..3 to the low and 4..7 to the high lane, four times each */
+	const __m256i spread = _mm256_setr_epi8(
+		0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+		4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7
+	);
+	/* both alpha lanes are 255 to get an opaque result */
+	const __m256i bg16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)(bg | 0xFF000000)), zero);
+	const __m256i fg16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)(fg | 0xFF000000)), zero);
+	size_t i = 0;
+	for (; (i + 8) <= count; i += 8) {
+		/* load all mask values before the first store as they may overlap */
+		long long m8;
+		memcpy(&m8, mask + i, sizeof(m8));
+		const __m256i m = _mm256_shuffle_epi8(_mm256_set1_epi64x(m8), spread);
+		const __m256i mlo = _mm256_unpacklo_epi8(m, zero);
+		const __m256i mhi = _mm256_unpackhi_epi8(m, zero);
+		/* div255(background * (255 - mask) + foreground * mask) */
+		__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c255, mlo), bg16), _mm256_mullo_epi16(mlo, fg16));
+		__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c255, mhi), bg16), _mm256_mullo_epi16(mhi, fg16));
+		lo = _mm256_mulhi_epu16(_mm256_add_epi16(lo, c128), c257);
+		hi = _mm256_mulhi_epu16(_mm256_add_epi16(hi, c128), c257);
+		_mm256_storeu_si256((__m256i *)(img + (4 * i)), _mm256_packus_epi16(lo, hi));
+	}
+	colorizeC(img + (4 * i), mask + i, count - i, bg, fg);
+}
+
+
+static SIMD_TARGET_AVX2 size_t countCharAvx2(const char * data, const size_t size, const char ch) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i pattern = _mm256_set1_epi8(ch);
+	size_t res = 0;
+	size_t i = 0;
+	while ((i + 32) <= size) {
+		/* per byte lane counters; a block of at most 255 vectors cannot overflow them */
+		__m256i counts = zero;
+		for (size_t n = 0; n < 255 && (i + 32) <= size; n++, i += 32) {
+			const __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+			counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(v, pattern));
+		}
+		/* horizontal sum of the lane counters */
+		res += sumLanesAvx2(_mm256_sad_epu8(counts, zero));
+	}
+	return res + countCharC(data + i, size - i, ch);
+}
+
+
+static SIMD_TARGET_AVX2 size_t sumAbsSignedAvx2(const unsigned char * data, const size_t size) {
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sums = zero;
+	size_t i = 0;
+	for (; (i + 32) <= size; i += 32) {
+		const __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+		/* min(x, 256 - x) is the absolute value of the signed byte x */
+		sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_min_epu8(v, _mm256_sub_epi8(zero, v)), zero));
+	}
+	return sumLanesAvx2(sums) + sumAbsSignedC(data + i, size - i);
+}
+
+
+static SIMD_TARGET_AVX2 void addWeightAvx2(unsigned char * cover, const size_t count, const unsigned int weight) {
+	const __m256i w = _mm256_set1_epi8((char)weight);
+	size_t i = 0;
+	for (; (i + 32) <= count; i += 32) {
+		__m256i * p = (__m256i *)(cover + i);
+		_mm256_storeu_si256(p, _mm256_add_epi8(_mm256_loadu_si256(p), w));
+	}
+	addWeightC(cover + i, count - i, weight);
+}
+
+
+static SIMD_TARGET_AVX2 void blendMaskAvx2(unsigned char * mask, const unsigned char * cover, const size_t count, const unsigned int alpha) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c1 = _mm256_set1_epi16(1);
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const __m256i c257 = _mm256_set1_epi16(257);
+	const __m256i ca = _mm256_set1_epi16((short)alpha);
+	size_t i = 0;
+	for (; (i + 32) <= count; i += 32) {
+		const __m256i c = _mm256_loadu_si256((const __m256i *)(cover + i));
+		const __m256i d = _mm256_loadu_si256((const __m256i *)(mask + i));
+		/* a = div255(cover * alpha); a + div255((255 - a) * mask) */
+		const __m256i alo = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(c, zero), ca), c1), c257);
+		const __m256i ahi = _mm256_mulhi_epu16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(c, zero), ca), c1), c257);
+		const __m256i dlo = _mm256_mullo_epi16(_mm256_sub_epi16(c255, alo), _mm256_unpacklo_epi8(d, zero));
+		const __m256i dhi = _mm256_mullo_epi16(_mm256_sub_epi16(c255, ahi), _mm256_unpackhi_epi8(d, zero));
+		const __m256i lo = _mm256_add_epi16(alo, _mm256_mulhi_epu16(_mm256_add_epi16(dlo, c1), c257));
+		const __m256i hi = _mm256_add_epi16(ahi, _mm256_mulhi_epu16(_mm256_add_epi16(dhi, c1), c257));
+		_mm256_storeu_si256((__m256i *)(mask + i), _mm256_packus_epi16(lo, hi));
+	}
+	blendMaskC(mask + i, cover + i, count - i, alpha);
+}
+#endif /* SIMD_HAS_AVX2 */
+
+
+/** Generic C kernels. */
+static const tSimdKernels simdGeneric = {
+	colorizeC,
+	downsample2xC,
+	countCharC,
+	sumAbsSignedC,
+	addWeightC,
+	blendMaskC
+};
+
+
+#ifdef SIMD_HAS_SSE2
+/** SSE2 kernels. */
+static const tSimdKernels simdSse2 = {
+	colorizeSse2,
+	downsample2xSse2,
+	countCharSse2,
+	sumAbsSignedSse2,
+	addWeightSse2,
+	blendMaskSse2
+};
+#endif /* SIMD_HAS_SSE2 */
+
+
+#ifdef SIMD_HAS_AVX2
+/** AVX2 kernels. The downsampling is not worth a wider variant. */
+static const tSimdKernels simdAvx2 = {
+	colorizeAvx2,
+	downsample2xSse2,
+	countCharAvx2,
+	sumAbsSignedAvx2,
+	addWeightAvx2,
+	blendMaskAvx2
+};
+#endif /* SIMD_HAS_AVX2 */
+
+
+/** Selected kernels. Defaults to the instruction set of the compilation target. */
+#ifdef SIMD_HAS_SSE2
+static const tSimdKernels * simdKernels = &simdSse2;
+#else /* !SIMD_HAS_SSE2 */
+static const tSimdKernels * simdKernels = &simdGeneric;
+#endif /* !SIMD_HAS_SSE2 */
+
+
+/**
+ * Checks whether the given instruction set is supported by this build and
+ * by the processor and operating system it runs on.
+ *
+ * @param[in] isa - instruction set to check
+ * @return 1 if supported, else 0
+ */
+int simd_supports(const tSimdIsa isa) {
+	switch (isa) {
+	case SIMD_AUTO:
+	case SIMD_GENERIC:
+		return 1;
+#ifdef SIMD_HAS_SSE2
+	case SIMD_SSE2:
+		/* part of the compilation target */
+		return 1;
+#endif /* SIMD_HAS_SSE2 */
+#ifdef SIMD_HAS_AVX2
+	case SIMD_AVX2:
+# if defined(_MSC_VER)
+		{
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return 0;
+			__cpuid(info, 1);
+			/* the operating system needs to save the AVX registers (OSXSAVE and XCR0) */
+			if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) return 0;
+			__cpuidex(info, 7, 0);
+			return ((info[1] & (1 << 5)) != 0) ? 1 : 0;
+		}
+# else /* !_MSC_VER */
+		__builtin_cpu_init();
+		return (__builtin_cpu_supports("avx2") != 0) ? 1 : 0;
+# endif /* !_MSC_VER */
+#endif /* SIMD_HAS_AVX2 */
+	default:
+		return 0;
+	}
+}
+
+
+/**
+ * Selects the kernels of the given instruction set for all following calls.
+ * This is not thread-safe and should only be called once at startup.
+ *
+ * @param[in] isa - instruction set to use (SIMD_AUTO for the best one supported)
+ * @return 1 on success, 0 if not supported
+ */
+int simd_select(const tSimdIsa isa) {
+	if (simd_supports(isa) == 0) return 0;
+	switch (isa) {
+	case SIMD_AUTO:
+		if (simd_supports(SIMD_AVX2) != 0) return simd_select(SIMD_AVX2);
+		if (simd_supports(SIMD_SSE2) != 0) return simd_select(SIMD_SSE2);
+		return simd_select(SIMD_GENERIC);
+#ifdef SIMD_HAS_SSE2
+	case SIMD_SSE2:
+		simdKernels = &simdSse2;
+		break;
+#endif /* SIMD_HAS_SSE2 */
+#ifdef SIMD_HAS_AVX2
+	case SIMD_AVX2:
+		simdKernels = &simdAvx2;
+		break;
+#endif /* SIMD_HAS_AVX2 */
+	default:
+		simdKernels = &simdGeneric;
+		break;
+	}
+	return 1;
+}
+
+
+/**
+ * Blends between the given opaque background and foreground color according
+ * to the passed 8-bit coverage mask. The result is an opaque RGBA image. The
+ * mask may be stored in the last quarter of the image buffer, i.e. it may
+ * start at img + 3 * count, as each mask value is read before the
+ * overlapping image bytes get written.
+ *
+ * @param[out] img - RGBA image with count pixels
+ * @param[in] mask - coverage mask with count values
+ * @param[in] count - number of pixels
+ * @param[in] bg - background color in ABGR (alpha is ignored)
+ * @param[in] fg - foreground color in ABGR (alpha is ignored)
+ */
+void simd_colorize(unsigned char * img, const unsigned char * mask, const size_t count, const unsigned int bg, const unsigned int fg) {
+	simdKernels->colorize(img, mask, count, bg, fg);
+}
+
+
+/**
+ * Reduces the given RGBA image to half its width and height by averaging
+ * each 2x2 pixel block.
+ *
+ * @param[out] dst - destination RGBA image with (width / 2) * (height / 2) pixels
+ * @param[in] src - source RGBA image
+ * @param[in] width - source image width in pixels (needs to be even)
+ * @param[in] height - source image height in pixels (needs to be even)
+ */
+void simd_downsample2x(unsigned char * dst, const unsigned char * src, const size_t width, const size_t height) {
+	simdKernels->downsample2x(dst, src, width, height);
+}
+
+
+/**
+ * Counts the occurrences of the given character in the passed memory block.
+ *
+ * @param[in] data - memory block to search
+ * @param[in] size - number of bytes in data
+ * @param[in] ch - character to count
+ * @return number of occurrences
+ */
+size_t simd_countChar(const char * data, const size_t size, const char ch) {
+	return simdKernels->countChar(data, size, ch);
+}
+
+
+/**
+ * Sums the absolute values of the given bytes interpreted as signed values.
+ * This is the PNG filter selection heuristic for filtered rows.
+ *
+ * @param[in] data - filtered bytes
+ * @param[in] size - number of bytes in data
+ * @return sum of the absolute values
+ */
+size_t simd_sumAbsSigned(const unsigned char * data, const size_t size) {
+	return simdKernels->sumAbsSigned(data, size);
+}
+
+
+/**
+ * Returns the kernel of the selected instruction set which adds a weight
+ * (0..255) to each coverage value. The values wrap around like the unsigned
+ * byte arithmetic of the rasterizer. The kernel can be passed directly to
+ * nsvgSetCoverageKernels().
+ *
+ * @return kernel function
+ */
+tSimdAddWeight simd_getAddWeight(void) {
+	return simdKernels->addWeight;
+}
+
+
+/**
+ * Returns the kernel of the selected instruction set which blends coverage
+ * values with a paint alpha (0..255) over an 8-bit coverage mask. The integer
+ * maths matches the rasterizer. The kernel can be passed directly to
+ * nsvgSetCoverageKernels().
+ *
+ * @return kernel function
+ */
+tSimdBlendMask simd_getBlendMask(void) {
+	return simdKernels->blendMask;
+}
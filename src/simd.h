@@ -0,0 +1,63 @@
+/**
+ * @file simd.h
+ * @author Daniel Starke
+ * @see simd.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Possible instruction sets of the optimized kernels. */
+typedef enum {
+	SIMD_AUTO,    /**< best instruction set supported by the processor */
+	SIMD_GENERIC, /**< portable C code */
+	SIMD_SSE2,    /**< SSE2 */
+	SIMD_AVX2     /**< AVX2 */
+} tSimdIsa;
+
+
+/** Kernel type of simd_getAddWeight() (matches NSVGfillRun). */
+typedef void (* tSimdAddWeight)(unsigned char * cover, size_t count, unsigned int weight);
+
+/** Kernel type of simd_getBlendMask() (matches NSVGblendMask). */
+typedef void (* tSimdBlendMask)(unsigned char * mask, const unsigned char * cover, size_t count, unsigned int alpha);
+
+
+int simd_supports(const tSimdIsa isa);
+int simd_select(const tSimdIsa isa);
+void simd_colorize(unsigned char * img, const unsigned char * mask, const size_t count, const unsigned int bg, const unsigned int fg);
+void simd_downsample2x(unsigned char * dst, const unsigned char * src, const size_t width, const size_t height);
+size_t simd_countChar(const char * data, const size_t size, const char ch);
+size_t simd_sumAbsSigned(const unsigned char * data, const size_t size);
+tSimdAddWeight simd_getAddWeight(void);
+tSimdBlendMask simd_getBlendMask(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __SIMD_H__ */
@@ -2,7 +2,7 @@
  * @file sm2lbpp.c
  * @author Daniel Starke
  * @date 2023-05-10
- * @version 2023-05-18
+ * @version 2026-10-18
  *
  * DISCLAIMER
  * This file has no copyright assigned and is placed in the Public Domain.
@@ -37,7 +37,12 @@ const TCHAR * fmsg[MSG_COUNT] = {
 	/* MSGT_ERR_PNG                  */ _T("Error: Failed to encode PNG image.\n"),
 	/* MSGT_WARN_NO_TOTAL_LINES      */ _T("Warning: 'file_total_lines' was not found.\n"),
 	/* MSGT_WARN_NO_TOTAL_LINES_LINE */ _T("Warning: Line with 'file_total_lines' is unterminated.\n"),
-	/* MSGT_INFO_PRESS_ENTER         */ _T("Press ENTER to exit.\n")
+	/* MSGT_INFO_PRESS_ENTER         */ _T("Press ENTER to exit.\n"),
+	/* MSGT_ERR_OPT_NO_ARG           */ _T("Error: Missing argument for option '%s'.\n"),
+	/* MSGT_ERR_OPT_BAD_ARG          */ _T("Error: Invalid argument for option '%s'.\n"),
+	/* MSGT_ERR_OPT_UNKNOWN          */ _T("Error: Unknown option '%s'.\n"),
+	/* MSGT_ERR_OPT_TOO_MANY_SIZES   */ _T("Error: Too many thumbnail sizes given.\n"),
+	/* MSGT_ERR_OPT_BAD_CPU          */ _T("Error: The processor does not support the instruction set '%s'.\n")
 };
 
 
@@ -45,6 +50,14 @@ const TCHAR * fmsg[MSG_COUNT] = {
  * Main entry point.
  */
 int _tmain(int argc, TCHAR ** argv) {
+	tSettings settings;
+	tContext * ctx = NULL;
+	int res = EXIT_SUCCESS;
+	int hasEncoder = 0;
+	tSimdIsa cpu = SIMD_AUTO;
+	const TCHAR * cpuArg = NULL;
+	int i;
+
 	/* set the output file descriptors */
 	fin  = stdin;
 	fout = stdout;
@@ -64,12 +77,150 @@ int _tmain(int argc, TCHAR ** argv) {
 	}
 #endif /* UNICODE */
 
-	if (argc < 2) {
+	/* set default settings */
+	memset(&settings, 0, sizeof(settings));
+	settings.strokeWidth = STROKE_WIDTH;
+	settings.borderWidth = BORDER_WIDTH;
+	settings.borderHeight = BORDER_HEIGHT;
+	settings.backgroundColor = BACKGROUND_COLOR;
+	settings.strokeColor = STROKE_COLOR;
+	settings.mode = RM_STROKE;
+	settings.jobs = 1;
+
+	/* parse options */
+	for (i = 1; i < argc; i++) {
+		const TCHAR * opt = argv[i];
+		const TCHAR * arg = argv[i + 1];
+		if (opt[0] != _T('-') || opt[1] == 0) break;
+		if (_tcscmp(opt, _T("--")) == 0) {
+			i++;
+			break;
+		}
+		if (isOption(opt, _T("-h"), _T("--help")) != 0) {
+			printHelp();
+			return EXIT_SUCCESS;
+		}
+		if (isOption(opt, _T("-i"), _T("--image-only")) != 0) {
+			settings.imageOnly = 1;
+			continue;
+		}
+		if (isOption(opt, _T("-p"), _T("--pipeline")) != 0) {
+			settings.pipeline = 1;
+			continue;
+		}
+		if (isOption(opt, _T("-u"), _T("--update")) != 0) {
+			settings.update = 1;
+			continue;
+		}
+		if (isOption(opt, _T("-z"), _T("--compact")) != 0) {
+			settings.compact = 1;
+			continue;
+		}
+		if (isOption(opt, _T("-a"), _T("--async")) == 0
+			&& isOption(opt, _T("-b"), _T("--border")) == 0
+			&& isOption(opt, _T("-c"), _T("--color")) == 0
+			&& isOption(opt, _T("-d"), _T("--cache")) == 0
+			&& isOption(opt, _T("-e"), _T("--encoder")) == 0
+			&& isOption(opt, _T("-g"), _T("--background")) == 0
+			&& isOption(opt, _T("-j"), _T("--jobs")) == 0
+			&& isOption(opt, _T("-m"), _T("--mode")) == 0
+			&& isOption(opt, _T("-s"), _T("--size")) == 0
+			&& isOption(opt, _T("-w"), _T("--stroke-width")) == 0
+			&& isOption(opt, _T("-x"), _T("--cpu")) == 0) {
+			_ftprintf(ferr, fmsg[MSGT_ERR_OPT_UNKNOWN], opt);
+			return EXIT_FAILURE;
+		}
+		/* all remaining options have an argument */
+		if ((i + 1) >= argc) {
+			_ftprintf(ferr, fmsg[MSGT_ERR_OPT_NO_ARG], opt);
+			return EXIT_FAILURE;
+		}
+		i++;
+		if (isOption(opt, _T("-a"), _T("--async")) != 0) {
+			if (parseCount(arg, &(settings.async), ASYNC_MAX_DEPTH) != 1) goto onBadArg;
+		} else if (isOption(opt, _T("-b"), _T("--border")) != 0) {
+			if (parseFloatPair(arg, &(settings.borderWidth), &(settings.borderHeight)) != 1) goto onBadArg;
+		} else if (isOption(opt, _T("-c"), _T("--color")) != 0) {
+			if (parseColor(arg, &(settings.strokeColor)) != 1) goto onBadArg;
+		} else if (isOption(opt, _T("-d"), _T("--cache")) != 0) {
+			if (arg[0] == 0) goto onBadArg;
+			settings.cacheDir = arg;
+		} else if (isOption(opt, _T("-e"), _T("--encoder")) != 0) {
+			if (parseEncoder(arg, &(settings.encoder)) != 1) goto onBadArg;
+			hasEncoder = 1;
+		} else if (isOption(opt, _T("-g"), _T("--background")) != 0) {
+			if (parseColor(arg, &(settings.backgroundColor)) != 1) goto onBadArg;
+		} else if (isOption(opt, _T("-j"), _T("--jobs")) != 0) {
+			if (parseCount(arg, &(settings.jobs), PNGENC_MAX_JOBS) != 1) goto onBadArg;
+			if (settings.jobs == 0) settings.jobs = (size_t)PCF_MIN(thread_cpuCount(), PNGENC_MAX_JOBS);
+		} else if (isOption(opt, _T("-m"), _T("--mode")) != 0) {
+			if (parseMode(arg, &(settings.mode)) != 1) goto onBadArg;
+		} else if (isOption(opt, _T("-s"), _T("--size")) != 0) {
+			if (settings.sizeCount >= MAX_THUMBNAILS) {
+				_ftprintf(ferr, _T("%s"), fmsg[MSGT_ERR_OPT_TOO_MANY_SIZES]);
+				return EXIT_FAILURE;
+			}
+			if (parseSize(arg, settings.size + settings.sizeCount) != 1) goto onBadArg;
+			settings.sizeCount++;
+		} else if (isOption(opt, _T("-w"), _T("--stroke-width")) != 0) {
+			if (parseFloatPair(arg, &(settings.strokeWidth), NULL) != 1) goto onBadArg;
+		} else if (isOption(opt, _T("-x"), _T("--cpu")) != 0) {
+			if (parseCpu(arg, &cpu) != 1) goto onBadArg;
+			cpuArg = arg;
+		}
+		continue;
+onBadArg:
+		_ftprintf(ferr, fmsg[MSGT_ERR_OPT_BAD_ARG], opt);
+		return EXIT_FAILURE;
+	}
+
+	/* the images are opaque; apply the stroke opacity once to the stroke color */
+	settings.strokeColor = blendColor(settings.backgroundColor, settings.strokeColor);
+	settings.backgroundColor |= 0xFF000000U;
+
+	if (simd_select(cpu) != 1) {
+		_ftprintf(ferr, fmsg[MSGT_ERR_OPT_BAD_CPU], cpuArg);
+		return EXIT_FAILURE;
+	}
+
+	if (hasEncoder == 0 && settings.jobs > 1) {
+		/* libpng cannot use multiple threads */
+		settings.encoder = PE_ZLIB;
+	}
+
+	if (settings.sizeCount == 0) {
+		settings.size[0].width = IMAGE_WIDTH;
+		settings.size[0].height = IMAGE_HEIGHT;
+		settings.sizeCount = 1;
+	}
+
+	if (i >= argc) {
 		printHelp();
 		return EXIT_FAILURE;
 	}
 
-	return (processFile(argv[1], &errorCallback) == 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+	/* process all given files */
+	ctx = createContext();
+	if (ctx == NULL) {
+		_ftprintf(ferr, _T("%s"), fmsg[MSGT_ERR_NO_MEM]);
+		return EXIT_FAILURE;
+	}
+	if (settings.async > 0) {
+		/* falls back to synchronous I/O if the threads cannot be created */
+		ctx->reader = io_createReader((const TCHAR * const *)(argv + i), (size_t)(argc - i), settings.async);
+		ctx->writer = io_createWriter(settings.async, &ioErrorCallback);
+	}
+	for (; i < argc; i++) {
+		if (processFile(ctx, argv[i], &settings, &errorCallback) != 1) {
+			res = EXIT_FAILURE;
+		}
+	}
+	/* wait for all pending writes */
+	if (io_deleteWriter(ctx->writer) > 0) res = EXIT_FAILURE;
+	io_deleteReader(ctx->reader);
+	deleteContext(ctx);
+
+	return res;
 }
 
 
@@ -78,7 +229,70 @@ int _tmain(int argc, TCHAR ** argv) {
  */
 void printHelp(void) {
 	_ftprintf(ferr,
-	_T("sm2lbpp <g-code file>\n")
+	_T("sm2lbpp [options] <g-code file> ...\n")
+	_T("\n")
+	_T("Pass - as file to read the G-Code from standard input and write the result\n")
+	_T("to standard output. The input is passed through unchanged if it cannot be\n")
+	_T("processed and the exit code indicates the error. Additional thumbnail sizes\n")
+	_T("are written as stdin-<w>x<h>.png to the current directory.\n")
+	_T("\n")
+	_T("-a, --async <n>\n")
+	_T("      Read up to n input files ahead and write up to n output files in the\n")
+	_T("      background while processing. Default: 0 (no background I/O)\n")
+	_T("-b, --border <w>[x<h>]\n")
+	_T("      Border clearance in workspace millimeters. Default: 1x1\n")
+	_T("-c, --color <rrggbb[aa]>\n")
+	_T("      Stroke color as hexadecimal RGB value with optional opacity.\n")
+	_T("      Default: 000000\n")
+	_T("-d, --cache <dir>\n")
+	_T("      Thumbnail cache directory. Files with the same G-Code and options reuse\n")
+	_T("      the thumbnails stored there instead of rendering them again.\n")
+	_T("-e, --encoder <name>\n")
+	_T("      PNG encoder. Default: libpng, or zlib if -j is given with n > 1\n")
+	_T("      libpng - reference encoder\n")
+	_T("      zlib   - built-in encoder with the compression of libpng\n")
+	_T("      fast   - built-in encoder with fast run-length compression\n")
+	_T("      The built-in encoders write RGB images, or grayscale images if both\n")
+	_T("      colors are gray.\n")
+	_T("-g, --background <rrggbb>\n")
+	_T("      Background color as hexadecimal RGB value. A given opacity is ignored.\n")
+	_T("      Default: ffffff\n")
+	_T("-h, --help\n")
+	_T("      Print this help.\n")
+	_T("-i, --image-only\n")
+	_T("      Write all thumbnails as PNG files (<file>-<w>x<h>.png) and leave the\n")
+	_T("      G-Code file untouched. With - as file, the first thumbnail is written to\n")
+	_T("      standard output.\n")
+	_T("-j, --jobs <n>\n")
+	_T("      Compress the PNG images with n threads if a built-in encoder is used.\n")
+	_T("      0 uses one thread per processor. Default: 1\n")
+	_T("-m, --mode <mode>\n")
+	_T("      Render mode. Default: stroke\n")
+	_T("      stroke - draw all powered moves with the stroke color\n")
+	_T("      power  - blend the stroke color by the laser power (e.g. for images)\n")
+	_T("-p, --pipeline\n")
+	_T("      Render in a second thread while parsing. This requires the work area\n")
+	_T("      bounds (min_x(mm), min_y(mm), max_x(mm), max_y(mm)) in the G-Code header,\n")
+	_T("      which are used as image bounds. Only spans and power mode paths are\n")
+	_T("      rendered this way.\n")
+	_T("-s, --size <w>x<h>\n")
+	_T("      Adds a thumbnail size in pixels. This option can be given up to ") _T2(TO_STR2(MAX_THUMBNAILS)) _T(" times.\n")
+	_T("      The first size is embedded into the G-Code file. All other sizes are\n")
+	_T("      written next to it as <file>-<w>x<h>.png. Default: ") _T2(TO_STR2(IMAGE_WIDTH)) _T("x") _T2(TO_STR2(IMAGE_HEIGHT)) _T("\n")
+	_T("-u, --update\n")
+	_T("      Replace the thumbnail of already post-processed files if the G-Code or\n")
+	_T("      the thumbnail options changed. Up-to-date files are left untouched.\n")
+	_T("-w, --stroke-width <mm>\n")
+	_T("      Laser point diameter in workspace millimeters. Default: 0.3\n")
+	_T("-x, --cpu <isa>\n")
+	_T("      Instruction set used by the optimized routines. Default: auto\n")
+	_T("      auto    - best instruction set supported by the processor\n")
+	_T("      generic - plain C routines\n")
+	_T("      sse2    - SSE2 routines\n")
+	_T("      avx2    - AVX2 routines\n")
+	_T("-z, --compact\n")
+	_T("      Keep the parsed paths in a compact fixed-point encoding with a\n")
+	_T("      resolution of 1/1024 mm. This reduces the memory needed for large files.\n")
 	_T("\n")
 	_T("sm2lbpp ") _T2(PROGRAM_VERSION_STR) _T("\n")
 	_T("https://github.com/daniel-starke/sm2lbpp\n")
@@ -86,6 +300,243 @@ void printHelp(void) {
 }
 
 
+/**
+ * Checks whether the given command-line argument matches the passed short or long option.
+ *
+ * @param[in] arg - command-line argument
+ * @param[in] shortOpt - short option name
+ * @param[in] longOpt - long option name
+ * @return 1 if matching, else 0
+ */
+int isOption(const TCHAR * arg, const TCHAR * shortOpt, const TCHAR * longOpt) {
+	return (_tcscmp(arg, shortOpt) == 0 || _tcscmp(arg, longOpt) == 0) ? 1 : 0;
+}
+
+
+/**
+ * Parses a size argument in the format "<w>x<h>".
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] size - parsed size
+ * @return 1 on success, else 0
+ */
+int parseSize(const TCHAR * arg, tSize * size) {
+	TCHAR * endPtr;
+	const long w = _tcstol(arg, &endPtr, 10);
+	if (endPtr == arg || (*endPtr != _T('x') && *endPtr != _T('X'))) return 0;
+	arg = endPtr + 1;
+	const long h = _tcstol(arg, &endPtr, 10);
+	if (endPtr == arg || *endPtr != 0) return 0;
+	if (w < 1 || w > IMAGE_MAX_SIZE || h < 1 || h > IMAGE_MAX_SIZE) return 0;
+	size->width = (int)w;
+	size->height = (int)h;
+	return 1;
+}
+
+
+/**
+ * Parses a non-negative integer argument.
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] value - parsed value
+ * @param[in] maxValue - maximum allowed value
+ * @return 1 on success, else 0
+ */
+int parseCount(const TCHAR * arg, size_t * value, const size_t maxValue) {
+	TCHAR * endPtr;
+	const long x = _tcstol(arg, &endPtr, 10);
+	if (endPtr == arg || *endPtr != 0) return 0;
+	if (x < 0 || (unsigned long)x > maxValue) return 0;
+	*value = (size_t)x;
+	return 1;
+}
+
+
+/**
+ * Parses a positive float value or a pair in the format "<a>x<b>". The
+ * first value is used for both if only one was given.
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] a - first value
+ * @param[out] b - second value (NULL if only a single value is allowed)
+ * @return 1 on success, else 0
+ */
+int parseFloatPair(const TCHAR * arg, float * a, float * b) {
+	TCHAR * endPtr;
+	const double x = _tcstod(arg, &endPtr);
+	double y = x;
+	if (endPtr == arg || !(x >= 0.0)) return 0;
+	if (b != NULL && (*endPtr == _T('x') || *endPtr == _T('X'))) {
+		arg = endPtr + 1;
+		y = _tcstod(arg, &endPtr);
+		if (endPtr == arg || !(y >= 0.0)) return 0;
+	}
+	if (*endPtr != 0) return 0;
+	*a = (float)x;
+	if (b != NULL) *b = (float)y;
+	return 1;
+}
+
+
+/**
+ * Parses a color argument in the format "rrggbb" or "rrggbbaa".
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] color - parsed color in ABGR (opaque if no alpha was given)
+ * @return 1 on success, else 0
+ */
+int parseColor(const TCHAR * arg, unsigned int * color) {
+	const size_t len = _tcslen(arg);
+	unsigned long value = 0;
+	if (len != 6 && len != 8) return 0;
+	/* parsed digit by digit to reject signs, white-space and prefixes like 0x */
+	for (size_t i = 0; i < len; i++) {
+		const TCHAR ch = arg[i];
+		unsigned long digit;
+		if (ch >= _T('0') && ch <= _T('9')) {
+			digit = (unsigned long)(ch - _T('0'));
+		} else if (ch >= _T('a') && ch <= _T('f')) {
+			digit = (unsigned long)(ch - _T('a') + 10);
+		} else if (ch >= _T('A') && ch <= _T('F')) {
+			digit = (unsigned long)(ch - _T('A') + 10);
+		} else {
+			return 0;
+		}
+		value = (value << 4) | digit;
+	}
+	if (len == 6) value = (value << 8) | 0xFF;
+	*color = COLOR((unsigned int)((value >> 24) & 0xFF), (unsigned int)((value >> 16) & 0xFF), (unsigned int)((value >> 8) & 0xFF), (unsigned int)(value & 0xFF));
+	return 1;
+}
+
+
+/**
+ * Blends the given foreground color over the opaque background color
+ * according to the alpha value of the foreground color.
+ *
+ * @param[in] bg - background color in ABGR (alpha is ignored)
+ * @param[in] fg - foreground color in ABGR
+ * @return opaque blended color in ABGR
+ */
+unsigned int blendColor(const unsigned int bg, const unsigned int fg) {
+	const unsigned int a = fg >> 24;
+	unsigned int res = 0xFF000000U;
+	for (unsigned int shift = 0; shift < 24; shift += 8) {
+		const unsigned int b = (bg >> shift) & 0xFF;
+		const unsigned int f = (fg >> shift) & 0xFF;
+		res |= (((f * a) + (b * (255 - a)) + 127) / 255) << shift;
+	}
+	return res;
+}
+
+
+/**
+ * Parses a PNG encoder argument.
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] encoder - parsed PNG encoder
+ * @return 1 on success, else 0
+ */
+int parseEncoder(const TCHAR * arg, tPngEncoder * encoder) {
+	if (_tcscmp(arg, _T("libpng")) == 0) {
+		*encoder = PE_LIBPNG;
+	} else if (_tcscmp(arg, _T("zlib")) == 0) {
+		*encoder = PE_ZLIB;
+	} else if (_tcscmp(arg, _T("fast")) == 0) {
+		*encoder = PE_FAST;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Parses an instruction set argument.
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] isa - parsed instruction set
+ * @return 1 on success, else 0
+ */
+int parseCpu(const TCHAR * arg, tSimdIsa * isa) {
+	if (_tcscmp(arg, _T("auto")) == 0) {
+		*isa = SIMD_AUTO;
+	} else if (_tcscmp(arg, _T("generic")) == 0) {
+		*isa = SIMD_GENERIC;
+	} else if (_tcscmp(arg, _T("sse2")) == 0) {
+		*isa = SIMD_SSE2;
+	} else if (_tcscmp(arg, _T("avx2")) == 0) {
+		*isa = SIMD_AVX2;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Parses a render mode argument.
+ *
+ * @param[in] arg - argument to parse
+ * @param[out] mode - parsed render mode
+ * @return 1 on success, else 0
+ */
+int parseMode(const TCHAR * arg, tRenderMode * mode) {
+	if (_tcscmp(arg, _T("stroke")) == 0) {
+		*mode = RM_STROKE;
+	} else if (_tcscmp(arg, _T("power")) == 0) {
+		*mode = RM_POWER;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+
+/** Character class of the given character (see tCharClass). */
+#define CHAR_CLASS(c) ( \
+	((c) >= '0' && (c) <= '9') ? CC_DIGIT : \
+	((c) == '.') ? CC_FRAC : \
+	((c) == '-') ? CC_SIGN : \
+	((c) == '\n') ? (CC_SPACE | CC_EOL) : \
+	((c) == ';') ? CC_EOL : \
+	((c) == ' ' || ((c) >= '\t' && (c) <= '\r')) ? CC_SPACE : \
+	0)
+
+/** G-Code letter of the given character (see tParam). Lower case letters are accepted. */
+#define CHAR_PARAM(c) ( \
+	((c) == 'G' || (c) == 'g') ? P_G : \
+	((c) == 'M' || (c) == 'm') ? P_M : \
+	((c) == 'X' || (c) == 'x') ? P_X : \
+	((c) == 'Y' || (c) == 'y') ? P_Y : \
+	((c) == 'P' || (c) == 'p') ? P_P : \
+	((c) == 'I' || (c) == 'i') ? P_I : \
+	((c) == 'J' || (c) == 'j') ? P_J : \
+	((c) == 'R' || (c) == 'r') ? P_R : \
+	((c) == 'S' || (c) == 's') ? P_S : \
+	P_UNKNOWN)
+
+/** Expands to the 16 table entries starting at character n. */
+#define CHAR_ROW(f, n) \
+	f(n + 0x0), f(n + 0x1), f(n + 0x2), f(n + 0x3), f(n + 0x4), f(n + 0x5), f(n + 0x6), f(n + 0x7), \
+	f(n + 0x8), f(n + 0x9), f(n + 0xA), f(n + 0xB), f(n + 0xC), f(n + 0xD), f(n + 0xE), f(n + 0xF)
+
+/** Expands to the 256 table entries of all characters. */
+#define CHAR_TABLE(f) \
+	CHAR_ROW(f, 0x00), CHAR_ROW(f, 0x10), CHAR_ROW(f, 0x20), CHAR_ROW(f, 0x30), \
+	CHAR_ROW(f, 0x40), CHAR_ROW(f, 0x50), CHAR_ROW(f, 0x60), CHAR_ROW(f, 0x70), \
+	CHAR_ROW(f, 0x80), CHAR_ROW(f, 0x90), CHAR_ROW(f, 0xA0), CHAR_ROW(f, 0xB0), \
+	CHAR_ROW(f, 0xC0), CHAR_ROW(f, 0xD0), CHAR_ROW(f, 0xE0), CHAR_ROW(f, 0xF0)
+
+
+/** Character class lookup table of the G-Code tokenizer. This replaces the locale dependent ctype functions. */
+static const unsigned char charClass[256] = { CHAR_TABLE(CHAR_CLASS) };
+
+
+/** G-Code letter lookup table of the G-Code tokenizer. */
+static const unsigned char charParam[256] = { CHAR_TABLE(CHAR_PARAM) };
+
+
 /**
  * Converts the given token into a unsigned integer value.
  *
@@ -153,53 +604,26 @@ endOfNumber:
 }
 
 
-/**
- * Deletes the given SVG image.
- *
- * @param[in,out] svg - SVG to delete
- */
-static void deleteSvg(NSVGimage * svg) {
-	NSVGshape * snext, * shape;
-	NSVGpath * pnext, * path;
-	if (svg == NULL) {
-		return;
-	}
-	shape = svg->shapes;
-	while (shape != NULL) {
-		snext = shape->next;
-		path = shape->paths;
-		while (path != NULL) {
-			pnext = path->next;
-			free(path);
-			path = pnext;
-		}
-		free(shape);
-		shape = snext;
-	}
-	free(svg);
-}
-
-
 /**
  * Creates and initializes a nanosvg shape.
  *
+ * @param[in,out] arena - arena to allocate from
+ * @param[in] settings - user settings
  * @return created shape or NULL on allocation error
  */
-static NSVGshape * createShape(void) {
-	NSVGshape * shape = (NSVGshape *)malloc(sizeof(NSVGshape));
+static NSVGshape * createShape(tArena * arena, const tSettings * settings) {
+	NSVGshape * shape = (NSVGshape *)arena_calloc(arena, sizeof(NSVGshape));
 	if (shape == NULL) return NULL;
-	memset(shape, 0, sizeof(NSVGshape));
 	shape->opacity = 1.0; /* opaque */;
-	shape->strokeWidth = STROKE_WIDTH;
+	shape->strokeWidth = settings->strokeWidth;
 	shape->strokeLineJoin = NSVG_JOIN_ROUND;
 	shape->strokeLineCap = NSVG_CAP_ROUND;
 	shape->miterLimit = 4.0f;
 	shape->fillRule = NSVG_FILLRULE_NONZERO;
 	shape->flags = NSVG_FLAGS_VISIBLE;
-	shape->fill.type = NSVG_PAINT_COLOR;
-	shape->fill.value.color = FILL_COLOR;
+	shape->fill.type = NSVG_PAINT_NONE; /* only strokes are rendered */
 	shape->stroke.type = NSVG_PAINT_COLOR;
-	shape->stroke.value.color = STROKE_COLOR;
+	shape->stroke.value.color = settings->strokeColor;
 	/* gradient transformation matrix: identity transformation (unused) */
 	shape->xform[0] = 1.0f;
 	shape->xform[1] = 0.0f;
@@ -212,67 +636,41 @@ static NSVGshape * createShape(void) {
 
 
 /**
- * Allocates and/or growths the given point vector if no more elements
- * can be added.
+ * Makes room for at least one more point in the given point vector. A new
+ * chunk is allocated from the arena if the current one is full. The points
+ * of the current path are carried over to the new chunk. This is at most
+ * the start point as longer paths are split by splitPath() before.
  *
- * @param[in,out] vec - point vector to use (NULL to allocate)
- * @return The vector on success, or NULL on allocation/reallocation error.
+ * @param[in,out] vec - point vector to use
+ * @return The vector on success, or NULL on allocation error.
  */
 static tPointVec * growPointVec(tPointVec * vec) {
 	if (vec == NULL) {
-		vec = (tPointVec *)malloc(sizeof(tPointVec));
-		if (vec == NULL) {
-			return NULL;
-		}
-		memset(vec, 0, sizeof(tPointVec));
-	}
-	if (vec->data == NULL) {
-		vec->capacity = (size_t)(VEC_INIT_SIZE / (2 * sizeof(float)));
-		vec->data = (float *)malloc(2 * vec->capacity * sizeof(float));
-		if (vec->data == NULL) {
-			free(vec);
-			return NULL;
-		}
+		return NULL;
 	}
 	if (vec->size >= vec->capacity) {
-		/* grow vector capacity if insufficient */
-		if (vec->capacity <= (size_t)(VEC_MAX_GROW_SIZE / (2 * sizeof(float)))) {
-			vec->capacity *= 2;
-		} else {
-			vec->capacity += (size_t)(VEC_MAX_GROW_SIZE / (2 * sizeof(float)));
-		}
-		float * newData = (float *)realloc(vec->data, 2 * vec->capacity * sizeof(float));
+		const size_t count = vec->size - vec->start;
+		const size_t capacity = (size_t)(POINT_CHUNK_SIZE / (2 * sizeof(float)));
+		float * newData = (float *)arena_alloc(vec->arena, 2 * capacity * sizeof(float));
 		if (newData == NULL) {
-			free(vec->data);
-			free(vec);
 			return NULL;
 		}
+		if (count > 0) {
+			memcpy(newData, vec->data + (2 * vec->start), 2 * count * sizeof(float));
+		}
 		vec->data = newData;
+		vec->start = 0;
+		vec->size = count;
+		vec->capacity = capacity;
 	}
 	return vec;
 }
 
 
-/**
- * Deletes the given point vector.
- *
- * @param[in,out] vec - vector to delete
- */
-static void deletePointVec(tPointVec * vec) {
-	if (vec == NULL) {
-		return;
-	}
-	if (vec->data != NULL) {
-		free(vec->data);
-	}
-	free(vec);
-}
-
-
 /**
  * Adds a point to the given point vector.
  *
- * @param[in,out] vec - point vector to use (NULL to allocate)
+ * @param[in,out] vec - point vector to use
  * @param[in] x - x coordinate of the point to add
  * @param[in] y - y coordinate of the point to add
  * @return The vector on success, or NULL on allocation/reallocation error.
@@ -294,7 +692,7 @@ static tPointVec * addPoint(tPointVec * vec, const float x, const float y) {
  * Adds the cubic bezier curve parameters for a straight line to the
  * given point vector.
  *
- * @param[in] vec - point vector to use (NULL to allocate)
+ * @param[in] vec - point vector to use
  * @param[in] x - x coordinate of the destination point of the line
  * @param[in] y - y coordinate of the destination point of the line
  * @return The vector on success, or NULL on allocation/reallocation error.
@@ -320,31 +718,210 @@ static tPointVec * addLine(tPointVec * vec, const float x, const float y) {
 }
 
 
+/**
+ * Calculates the arc center for the radius form of G2/G3. A positive radius
+ * selects the arc with less than 180 degrees, a negative one the arc with
+ * more than 180 degrees.
+ *
+ * @param[in] x0 - x coordinate of the arc start point
+ * @param[in] y0 - y coordinate of the arc start point
+ * @param[in] x1 - x coordinate of the arc end point
+ * @param[in] y1 - y coordinate of the arc end point
+ * @param[in] r - signed arc radius
+ * @param[in] clockwise - set to 1 for clockwise arcs (G2), else 0 (G3)
+ * @param[out] cx - x coordinate of the arc center
+ * @param[out] cy - y coordinate of the arc center
+ * @return 1 on success, else 0 if no such arc exists
+ */
+static int getArcCenter(const float x0, const float y0, const float x1, const float y1, const float r, const int clockwise, float * cx, float * cy) {
+	const float dx = x1 - x0;
+	const float dy = y1 - y0;
+	const float d = sqrtf((dx * dx) + (dy * dy));
+	if (d <= 0.0f || r == 0.0f) {
+		return 0;
+	}
+	/* a slightly too small radius is treated as half circle */
+	const float h2 = (4.0f * r * r) - (d * d);
+	float h = (h2 > 0.0f) ? (-sqrtf(h2) / d) : 0.0f;
+	if (clockwise == 0) {
+		h = -h;
+	}
+	if (r < 0.0f) {
+		h = -h;
+	}
+	*cx = x0 + (0.5f * (dx - (dy * h)));
+	*cy = y0 + (0.5f * (dy + (dx * h)));
+	return 1;
+}
+
+
+/**
+ * Adds the cubic bezier curve parameters for a circular arc from the last
+ * point to the given destination point. The arc is split at the quadrant
+ * boundaries. Hence, each curve spans at most 90 degrees and the curve end
+ * points include the arc extrema. A full circle is added if the start and
+ * end point are the same. The radius is interpolated linearly if the
+ * distances of the start and end point to the center differ.
+ *
+ * @param[in] vec - point vector to use
+ * @param[in] cx - x coordinate of the arc center
+ * @param[in] cy - y coordinate of the arc center
+ * @param[in] x - x coordinate of the arc end point
+ * @param[in] y - y coordinate of the arc end point
+ * @param[in] clockwise - set to 1 for clockwise arcs (G2), else 0 (G3)
+ * @return The vector on success, or NULL on allocation/reallocation error.
+ */
+static tPointVec * addArc(tPointVec * vec, const float cx, const float cy, const float x, const float y, const int clockwise) {
+	static const float halfPi = 1.57079632679489662f;
+	static const float twoPi = 6.28318530717958648f;
+	if (vec == NULL || vec->data == NULL) {
+		return NULL;
+	}
+	const float * pts = vec->data + (2 * (vec->size - 1));
+	const float r0 = sqrtf(((pts[0] - cx) * (pts[0] - cx)) + ((pts[1] - cy) * (pts[1] - cy)));
+	const float r1 = sqrtf(((x - cx) * (x - cx)) + ((y - cy) * (y - cy)));
+	const float a0 = atan2f(pts[1] - cy, pts[0] - cx);
+	float sweep = atan2f(y - cy, x - cx) - a0;
+	if (clockwise != 0) {
+		if (sweep >= -1e-6f) sweep -= twoPi;
+	} else {
+		if (sweep <= 1e-6f) sweep += twoPi;
+	}
+	float a = a0;
+	float r = r0;
+	for (;;) {
+		/* next quadrant boundary in sweep direction */
+		float b = (clockwise != 0) ? (ceilf((a / halfPi) - 1e-4f) - 1.0f) * halfPi : (floorf((a / halfPi) + 1e-4f) + 1.0f) * halfPi;
+		const float rest = (a0 + sweep) - b;
+		const int isLast = (clockwise != 0) ? (rest > -1e-4f) : (rest < 1e-4f);
+		if (isLast != 0) {
+			b = a0 + sweep;
+		}
+		const float theta = b - a;
+		const float rb = r0 + ((r1 - r0) * ((b - a0) / sweep));
+		const float k = (4.0f / 3.0f) * tanf(theta / 4.0f);
+		const float cosA = cosf(a), sinA = sinf(a);
+		const float cosB = cosf(b), sinB = sinf(b);
+		const float ex = (isLast != 0) ? x : (cx + (rb * cosB));
+		const float ey = (isLast != 0) ? y : (cy + (rb * sinB));
+		vec = addPoint(vec, cx + (r * cosA) - (k * r * sinA), cy + (r * sinA) + (k * r * cosA));
+		if (vec == NULL) {
+			return NULL;
+		}
+		vec = addPoint(vec, ex + (k * rb * sinB), ey - (k * rb * cosB));
+		if (vec == NULL) {
+			return NULL;
+		}
+		vec = addPoint(vec, ex, ey);
+		if (vec == NULL || isLast != 0) {
+			return vec;
+		}
+		a = b;
+		r = rb;
+	}
+}
+
+
+/**
+ * Returns the scratch buffer of the given context with at least the given
+ * size. The content is not preserved if the buffer grows.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] size - minimum size in bytes
+ * @return scratch buffer or NULL on allocation error
+ */
+static void * getScratch(tContext * ctx, const size_t size) {
+	if (size > ctx->scratchSize) {
+		void * newScratch = malloc(size);
+		if (newScratch == NULL) {
+			return NULL;
+		}
+		if (ctx->scratch != NULL) {
+			free(ctx->scratch);
+		}
+		ctx->scratch = newScratch;
+		ctx->scratchSize = size;
+	}
+	return ctx->scratch;
+}
+
+
+/**
+ * Returns the points of the given path. Compact encoded paths are decoded
+ * into the scratch buffer of the passed context. The scratch buffer is
+ * already large enough for the largest path (see pointsToPath()).
+ *
+ * @param[in,out] userData - processing context
+ * @param[in] path - path to get the points from
+ * @return path points
+ * @see nsvgSetPathDecoder()
+ */
+static const float * getPathPoints(void * userData, const NSVGpath * path) {
+	const tPath * pwrPath = (const tPath *)path;
+	if (pwrPath->code == NULL) {
+		return path->pts;
+	}
+	tContext * ctx = (tContext *)userData;
+	float * pts = (float *)(ctx->scratch);
+	cp_decodePath(pts, pwrPath->code, (size_t)path->npts, pwrPath->origin[0], pwrPath->origin[1]);
+	return pts;
+}
+
+
 /**
  * Adds a new path from the passed point vector to the given one.
- * This also clear the passed point vector on success.
+ * This also clear the passed point vector on success. The points are moved
+ * into the compact encoding if enabled by the user settings, which frees
+ * their space in the point vector again.
  *
+ * @param[in,out] ctx - processing context
+ * @param[in] settings - user settings
  * @param[in,out] pathPtr - pointer to previous path handle
  * @param[in,out] points - point vector to add
+ * @param[in] power - laser power of the path in percent
  * @return The added path on success, else NULL on allocation error.
  */
-static NSVGpath * pointsToPath(NSVGpath ** pathPtr, tPointVec * points) {
+static NSVGpath * pointsToPath(tContext * ctx, const tSettings * settings, NSVGpath ** pathPtr, tPointVec * points, const float power) {
 	if (pathPtr == NULL || points == NULL || points->data == NULL || (points->size - points->start) <= 1) {
 		return NULL; /* invalid value */
 	}
-	NSVGpath * path = (NSVGpath *)malloc(sizeof(NSVGpath));
-	if (path == NULL) {
+	tPath * pwrPath = (tPath *)arena_calloc(ctx->arena, sizeof(tPath));
+	if (pwrPath == NULL) {
 		return NULL;
 	}
-	memset(path, 0, sizeof(NSVGpath));
-	/* Only remember start position here.
-	 * The actual offset to points->data will be set later
-	 * via setPointsDataOffset() to avoid invalid pointers
-	 * if realloc() returns a new location in growPointVec().
-	 */
-	path->pts = (float *)(2 * points->start);
-	path->npts = (int)(points->size - points->start);
-	points->start = points->size; /* reset start */
+	pwrPath->power = power;
+	/* split paths have no caps at the split points */
+	pwrPath->caps = (points->isContinued != 0) ? ACCUM_CAP_END : ACCUM_CAP_BOTH;
+	points->isContinued = 0;
+	NSVGpath * path = &(pwrPath->path);
+	const float * pts = points->data + (2 * points->start);
+	const size_t npts = points->size - points->start;
+	path->npts = (int)npts;
+	if (settings->compact != 0) {
+		/* encode to scratch buffer first as the final size is not known in advance */
+		const size_t decodedSize = 2 * npts * sizeof(float);
+		const size_t encodedSize = cp_maxEncodedSize(npts);
+		/* this also reserves the space to decode the path during rendering */
+		unsigned char * buf = (unsigned char *)getScratch(ctx, PCF_MAX(encodedSize, decodedSize));
+		if (buf == NULL) {
+			return NULL;
+		}
+		const size_t size = cp_encodePath(buf, pts, npts);
+		unsigned char * code = (unsigned char *)arena_alloc(ctx->arena, size + 1);
+		if (code == NULL) {
+			return NULL;
+		}
+		memcpy(code, buf, size);
+		pwrPath->code = code;
+		pwrPath->origin[0] = pts[0];
+		pwrPath->origin[1] = pts[1];
+		/* the float points are no longer needed */
+		points->size = points->start;
+	} else {
+		/* the points of the path are never moved by growPointVec() */
+		path->pts = (float *)pts;
+		points->start = points->size; /* reset start */
+	}
 	/* set previous path's next pointer */
 	*pathPtr = path;
 	return path;
@@ -352,142 +929,1208 @@ static NSVGpath * pointsToPath(NSVGpath ** pathPtr, tPointVec * points) {
 
 
 /**
- * Updates the path->pts offset to ptsBase to correctly map the
- * pointers after realloc() relocation in growPointVec().
+ * Adds a horizontal powered move to the given span vector. The vector is
+ * allocated and/or grown if needed.
+ *
+ * @param[in,out] vec - span vector to use (NULL to allocate)
+ * @param[in] x0 - start x coordinate of the move
+ * @param[in] x1 - end x coordinate of the move
+ * @param[in] y - y coordinate of the move
+ * @param[in] power - laser power in percent
+ * @param[in] isFirst - set to 1 if this span starts a new scan line run
+ * @return The vector on success, or NULL on allocation/reallocation error.
+ */
+static tSpanVec * addSpan(tSpanVec * vec, const float x0, const float x1, const float y, const float power, const int isFirst) {
+	if (vec == NULL) {
+		vec = (tSpanVec *)malloc(sizeof(tSpanVec));
+		if (vec == NULL) {
+			return NULL;
+		}
+		memset(vec, 0, sizeof(tSpanVec));
+	}
+	if (vec->size >= vec->capacity) {
+		/* grow vector capacity if insufficient */
+		size_t newCapacity;
+		if (vec->capacity == 0) {
+			newCapacity = (size_t)(VEC_INIT_SIZE / sizeof(tSpan));
+		} else if (vec->capacity <= (size_t)(VEC_MAX_GROW_SIZE / sizeof(tSpan))) {
+			newCapacity = 2 * vec->capacity;
+		} else {
+			newCapacity = vec->capacity + (size_t)(VEC_MAX_GROW_SIZE / sizeof(tSpan));
+		}
+		tSpan * newData = (tSpan *)realloc(vec->data, newCapacity * sizeof(tSpan));
+		if (newData == NULL) {
+			if (vec->data != NULL) {
+				free(vec->data);
+			}
+			free(vec);
+			return NULL;
+		}
+		vec->data = newData;
+		vec->capacity = newCapacity;
+	}
+	tSpan * span = vec->data + vec->size;
+	const int startCap = (isFirst != 0) ? ACCUM_CAP_START : ACCUM_CAP_NONE;
+	if (x0 <= x1) {
+		span->x0 = x0;
+		span->x1 = x1;
+		span->caps = startCap;
+	} else {
+		/* the run start is the right end of the span */
+		span->x0 = x1;
+		span->x1 = x0;
+		span->caps = (startCap != ACCUM_CAP_NONE) ? ACCUM_CAP_END : ACCUM_CAP_NONE;
+	}
+	span->y = y;
+	span->power = power;
+	vec->size++;
+	return vec;
+}
+
+
+/**
+ * Marks the last span of the given span vector as the end of a scan line run.
  *
- * @param[in] path - linked list of path objects
- * @param[in] ptsBase - new base pointer for path->pts
+ * @param[in,out] vec - span vector to use
+ * @param[in] x - end x coordinate of the scan line run
  */
-static void setPointsDataOffset(NSVGpath * path, float * ptsBase) {
-	while (path != NULL) {
-		path->pts = ptsBase + (ptrdiff_t)(path->pts);
-		path = path->next;
+static void endSpanRun(tSpanVec * vec, const float x) {
+	if (vec == NULL || vec->size < 1) {
+		return;
 	}
+	tSpan * span = vec->data + vec->size - 1;
+	span->caps |= (x >= span->x1) ? ACCUM_CAP_END : ACCUM_CAP_START;
 }
 
 
 /**
- * Sets the bounds to the given path with all its points.
+ * Deletes the given span vector.
  *
- * @param[in,out] path - path to set bounds for
+ * @param[in,out] vec - vector to delete
  */
-static void setPathBounds(NSVGpath * path) {
-	if (path == NULL) {
+static void deleteSpanVec(tSpanVec * vec) {
+	if (vec == NULL) {
 		return;
 	}
-	/* calculate bounds, assuming all straight lines */
-	for (int i = 0; (i + 3) < path->npts; i += 3) {
-		const float * curve = path->pts + (i * 2);
-		if (i == 0) {
-			path->bounds[0] = curve[0];
-			path->bounds[1] = curve[1];
-			path->bounds[2] = curve[6];
-			path->bounds[3] = curve[7];
-		} else {
-			path->bounds[0] = PCF_MIN(path->bounds[0], curve[0]);
-			path->bounds[1] = PCF_MIN(path->bounds[1], curve[1]);
-			path->bounds[2] = PCF_MAX(path->bounds[2], curve[6]);
-			path->bounds[3] = PCF_MAX(path->bounds[3], curve[7]);
-		}
+	if (vec->data != NULL) {
+		free(vec->data);
 	}
+	free(vec);
+}
+
+
+/**
+ * Adds the given PNG data block to the associated PNG object.
+ *
+ * @param[in] pngPtr - context
+ * @param[in] data - data to add
+ * @param[in] length - data length in number of bytes
+ */
+static void pngWriteData(png_structp pngPtr, png_bytep data, png_size_t length) {
+	tPng * png = (tPng *)png_get_io_ptr(pngPtr);
+	size_t newSize = png->size + length;
+	if (png->data != NULL) {
+		png->data = (png_bytep)realloc(png->data, newSize);
+	} else {
+		png->data = (png_bytep)malloc(newSize);
+	}
+	if (png->data == NULL) {
+		png_error(pngPtr, "Failed to allocate memory.");
+	}
+	memcpy(png->data + png->size, data, length);
+	png->size = newSize;
+}
+
+
+/**
+ * Sets the image header and the output function of the given PNG write
+ * structure.
+ *
+ * @param[in,out] pngPtr - PNG write structure
+ * @param[in,out] pngInfoPtr - PNG info structure
+ * @param[in] size - image size
+ * @param[in] png - PNG memory buffer
+ */
+static void setPngHeader(png_structp pngPtr, png_infop pngInfoPtr, const tSize * size, tPng * png) {
+	png_set_IHDR(
+		pngPtr, pngInfoPtr, (png_uint_32)size->width, (png_uint_32)size->height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE
+	);
+	png_set_write_fn(pngPtr, png, &pngWriteData, NULL);
+}
+
+
+/**
+ * Checks whether the given color is a shade of gray.
+ *
+ * @param[in] color - color in ABGR
+ * @return 1 if gray, else 0
+ */
+static int isGray(const unsigned int color) {
+	return (((color ^ (color >> 8)) & 0xFFFF) == 0) ? 1 : 0;
+}
+
+
+/**
+ * Starts a new PNG image with the built-in PNG encoder of the given context.
+ * All images are blended from the background and stroke color. They are
+ * written as grayscale images if both colors are gray, else as RGB images.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] settings - user settings
+ * @param[in] size - image size
+ * @return PNG encoder or NULL on error
+ */
+static tPngEnc * startPng(tContext * ctx, const tSettings * settings, const tSize * size) {
+	const int gray = isGray(settings->backgroundColor) & isGray(settings->strokeColor);
+	if (ctx->pngEnc == NULL) {
+		ctx->pngEnc = pngenc_create(settings->jobs);
+		if (ctx->pngEnc == NULL) return NULL;
+	}
+	if (pngenc_start(ctx->pngEnc, size->width, size->height, (gray != 0) ? PNGENC_GRAY : PNGENC_RGB, (settings->encoder == PE_FAST) ? PNGENC_FAST : PNGENC_DEFAULT) != 1) return NULL;
+	return ctx->pngEnc;
+}
+
+
+/**
+ * Completes the PNG image of the given encoder and passes it to the PNG memory
+ * buffer.
+ *
+ * @param[in,out] enc - PNG encoder with all rows added
+ * @param[out] png - PNG memory buffer
+ * @return 1 on success, 0 on error
+ */
+static int finishPng(tPngEnc * enc, tPng * png) {
+	png->data = (png_bytep)pngenc_finish(enc, &(png->size));
+	return (png->data != NULL) ? 1 : 0;
+}
+
+
+/**
+ * Writes the passed image vertically flipped to the given PNG memory buffer
+ * with the PNG encoder selected by the user settings.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] img - opaque RGBA image
+ * @param[in] size - image size
+ * @param[in] settings - user settings
+ * @param[in] png - PNG memory buffer
+ * @return 1 on success
+ * @return 0 on allocation error
+ * @return -1 on PNG internal error
+ */
+static int imgToPng(tContext * ctx, const png_bytep img, const tSize * size, const tSettings * settings, tPng * png) {
+	int res = 0;
+	png_structp pngPtr = NULL;
+	png_infop pngInfoPtr = NULL;
+	png_bytepp imgRows = NULL;
+
+	if (settings->encoder != PE_LIBPNG) {
+		const size_t stride = (size_t)size->width * 4;
+		tPngEnc * enc = startPng(ctx, settings, size);
+		if (enc == NULL) return 0;
+		/* pass the rows from the last to the first one to flip vertically */
+		if (pngenc_addRows(enc, img + ((size_t)(size->height - 1) * stride), -(ptrdiff_t)stride, (size_t)size->height) != 1) return 0;
+		return finishPng(enc, png);
+	}
+
+	/* flip vertically */
+	imgRows = (png_bytepp)malloc((size_t)size->height * sizeof(png_bytep));
+	if (imgRows == NULL) goto onError;
+	for (size_t i = 0; i < (size_t)size->height; i++) {
+		imgRows[(size_t)size->height - i - 1] = img + (i * (size_t)size->width * 4);
+	}
+
+	pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (pngPtr == NULL) goto onError;
+	pngInfoPtr = png_create_info_struct(pngPtr);
+	if (pngInfoPtr == NULL) goto onError;
+	if (setjmp(png_jmpbuf(pngPtr)) != 0) {
+		res = -1;
+		goto onError;
+	}
+	setPngHeader(pngPtr, pngInfoPtr, size, png);
+	png_set_rows(pngPtr, pngInfoPtr, imgRows);
+	png_write_png(pngPtr, pngInfoPtr, PNG_TRANSFORM_IDENTITY, NULL);
+
+	res = 1;
+onError:
+	if (pngInfoPtr != NULL) {
+		png_destroy_write_struct(&pngPtr, &pngInfoPtr);
+	} else if (pngPtr != NULL) {
+		png_destroy_write_struct(&pngPtr, NULL);
+	}
+	if (imgRows != NULL) free(imgRows);
+	return res;
+}
+
+
+/**
+ * Sets the image bounds from the given bounds of all powered moves. The
+ * realignment to (border width, border height) is folded into the render
+ * transformation.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in,out] svg - SVG image
+ * @param[in] settings - user settings
+ * @param[in] bounds - min x, min y, max x and max y of all powered moves
+ */
+static void setImageBounds(tContext * ctx, NSVGimage * svg, const tSettings * settings, const float * bounds) {
+	/* there is only one shape with all paths */
+	NSVGshape * shape = svg->shapes;
+	ctx->offset[0] = bounds[0] - settings->borderWidth;
+	ctx->offset[1] = bounds[1] - settings->borderHeight;
+	shape->bounds[0] = settings->borderWidth;
+	shape->bounds[1] = settings->borderHeight;
+	shape->bounds[2] = bounds[2] - ctx->offset[0];
+	shape->bounds[3] = bounds[3] - ctx->offset[1];
+	/* update resolution with border of (5, 5) */
+	svg->width = shape->bounds[2] + (2.0f * settings->borderWidth);
+	svg->height = shape->bounds[3] + (2.0f * settings->borderHeight);
+}
+
+
+/**
+ * Calculates the transformation from workspace coordinates to pixels which
+ * centers the given SVG image within the passed output image size.
+ *
+ * @param[in] ctx - processing context
+ * @param[in] svg - SVG image with valid width and height
+ * @param[in] size - output image size
+ * @param[out] tx - horizontal offset in pixels
+ * @param[out] ty - vertical offset in pixels
+ * @param[out] scale - scaling factor
+ */
+static void getRenderTransform(const tContext * ctx, const NSVGimage * svg, const tSize * size, float * tx, float * ty, float * scale) {
+	const float scaleX = (float)size->width / svg->width;
+	const float scaleY = (float)size->height / svg->height;
+	*scale = PCF_MIN(scaleX, scaleY);
+	/* calculate offset for centered output including the realignment offset */
+	*tx = (((float)size->width - (svg->width * *scale)) / 2.0f) - (ctx->offset[0] * *scale);
+	*ty = (((float)size->height - (svg->height * *scale)) / 2.0f) - (ctx->offset[1] * *scale);
+}
+
+
+/**
+ * Adds the given path to the passed accumulation buffer.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] path - path to add
+ * @param[in] pts - decoded points of the path
+ */
+static void accumulatePath(tAccum * acc, const NSVGpath * path, const float * pts) {
+	const float weight = ((const tPath *)path)->power / 100.0f;
+	const int pathCaps = ((const tPath *)path)->caps;
+	for (int i = 0; (i + 3) < path->npts; i += 3) {
+		const int caps = pathCaps & (((i == 0) ? ACCUM_CAP_START : ACCUM_CAP_NONE) | (((i + 4) >= path->npts) ? ACCUM_CAP_END : ACCUM_CAP_NONE));
+		acc_addCubic(acc, pts + (2 * i), weight, caps);
+	}
+}
+
+
+/**
+ * Adds the given span to the passed accumulation buffer.
+ *
+ * @param[in,out] acc - accumulation buffer
+ * @param[in] span - span to add
+ * @param[in] settings - user settings
+ */
+static void accumulateSpan(tAccum * acc, const tSpan * span, const tSettings * settings) {
+	const float weight = (settings->mode == RM_POWER) ? (span->power / 100.0f) : 1.0f;
+	acc_addSpan(acc, span->x0, span->x1, span->y, weight, span->caps);
+}
+
+
+/**
+ * Checks whether the given image size is rendered and encoded band by band
+ * instead of at once.
+ *
+ * @param[in] size - image size
+ * @return 1 if rendered band by band, else 0
+ */
+static int isBanded(const tSize * size) {
+	return (((size_t)size->width * (size_t)size->height) > RENDER_BAND_PIXELS) ? 1 : 0;
+}
+
+
+/**
+ * Checks whether rendering needs an accumulation buffer.
+ *
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @return 1 if needed, else 0
+ */
+static int needsAccum(const tSpanVec * spans, const tSettings * settings) {
+	return (settings->mode == RM_POWER || (spans != NULL && spans->size > 0)) ? 1 : 0;
+}
+
+
+/**
+ * Renders a band of rows of the given SVG image and scan line spans centered
+ * into the passed opaque RGBA image band. The SVG image width and height need
+ * to be set if it contains any path or span.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] svg - SVG image to render
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @param[in] size - output image size
+ * @param[in] firstRow - first image row of the band
+ * @param[in] rows - number of rows in the band
+ * @param[out] img - RGBA image band with size->width * rows pixels
+ * @param[in,out] acc - accumulation buffer with the size of the band (NULL if not needed)
+ * @param[in] isAccumulated - set to 1 if the render thread already filled acc
+ * @param[in] bands - data shared by all bands or NULL to render all paths and spans
+ * @param[in] band - band number within bands
+ */
+static void renderBand(tContext * ctx, NSVGimage * svg, const tSpanVec * spans, const tSettings * settings, const tSize * size, const int firstRow, const int rows, png_bytep img, tAccum * acc, const int isAccumulated, const tBands * bands, const int band) {
+	const size_t count = (size_t)size->width * (size_t)rows;
+	/* there is only one shape with all paths */
+	const NSVGshape * shape = svg->shapes;
+	const int hasPaths = (shape != NULL && shape->paths != NULL) ? 1 : 0;
+	const int hasSpans = (spans != NULL && spans->size > 0) ? 1 : 0;
+	float scale = 1.0f, tx = 0.0f, ty = 0.0f;
+	if (hasPaths != 0 || hasSpans != 0) {
+		getRenderTransform(ctx, svg, size, &tx, &ty, &scale);
+	}
+	if (acc != NULL && isAccumulated == 0) {
+		acc_setBand(acc, firstRow);
+		acc_setTransform(acc, tx, ty, scale, settings->strokeWidth);
+		/* scan line spans are written directly as horizontal runs */
+		if (bands != NULL && hasSpans != 0) {
+			for (size_t i = bands->spanStart[band]; i < bands->spanStart[band + 1]; i++) {
+				accumulateSpan(acc, spans->data + bands->spanIndex[i], settings);
+			}
+		} else {
+			for (size_t i = 0; hasSpans != 0 && i < spans->size; i++) {
+				accumulateSpan(acc, spans->data + i, settings);
+			}
+		}
+		if (settings->mode == RM_POWER) {
+			/* accumulate power weighted coverage of all paths in a single pass */
+			if (bands != NULL && hasPaths != 0) {
+				for (size_t i = bands->pathStart[band]; i < bands->pathStart[band + 1]; i++) {
+					const NSVGpath * path = bands->paths[bands->pathIndex[i]];
+					accumulatePath(acc, path, getPathPoints(ctx, path));
+				}
+			} else {
+				for (const NSVGpath * path = (hasPaths != 0) ? shape->paths : NULL; path != NULL; path = path->next) {
+					accumulatePath(acc, path, getPathPoints(ctx, path));
+				}
+			}
+		}
+	}
+	if (settings->mode == RM_POWER) {
+		acc_toImage(acc, (unsigned char *)img, settings->backgroundColor, settings->strokeColor);
+		return;
+	}
+	/* all strokes have the same color: render only their coverage into the last quarter of the image */
+	unsigned char * mask = (unsigned char *)img + (3 * count);
+	if (bands != NULL && bands->hasEdges != 0) {
+		nsvgRasterizePreparedBandMask(ctx->rast, mask, firstRow, rows, size->width);
+	} else if (hasPaths != 0) {
+		nsvgRasterizeBandMask(ctx->rast, svg, tx, ty, scale, mask, size->width, firstRow, rows, size->width);
+	} else {
+		/* fully transparent */
+		memset(mask, 0, count);
+	}
+	if (acc != NULL) {
+		acc_compositeMask(acc, mask);
+	}
+	/* colorize in-place to the opaque background and stroke color */
+	simd_colorize((unsigned char *)img, mask, count, settings->backgroundColor, settings->strokeColor);
+}
+
+
+/**
+ * Renders the given SVG image and scan line spans centered into a new opaque
+ * RGBA image. The SVG image width and height need to be set if it contains
+ * any path or span.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] svg - SVG image to render
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @param[in] size - output image size
+ * @param[in] acc - accumulation buffer filled by the render thread or NULL (always deleted)
+ * @return created image or NULL on allocation error
+ */
+static png_bytep renderImage(tContext * ctx, NSVGimage * svg, const tSpanVec * spans, const tSettings * settings, const tSize * size, tAccum * acc) {
+	/* the render thread already accumulated all spans and in power mode also all paths */
+	const int isAccumulated = (acc != NULL) ? 1 : 0;
+	png_bytep img = (png_bytep)malloc((size_t)size->width * (size_t)size->height * 4);
+	if (img == NULL) {
+		acc_delete(acc);
+		return NULL;
+	}
+	if (isAccumulated == 0 && needsAccum(spans, settings) != 0) {
+		acc = acc_create(size->width, size->height);
+		if (acc == NULL) {
+			free(img);
+			return NULL;
+		}
+	}
+	renderBand(ctx, svg, spans, settings, size, 0, size->height, img, acc, isAccumulated, NULL, 0);
+	acc_delete(acc);
+	return img;
+}
+
+
+/**
+ * Sorts the given items into the bands they cross. The bands are laid out
+ * like in renderBands().
+ *
+ * @param[in] rows - first and last image row of each item (skipped if first > last)
+ * @param[in] n - number of items
+ * @param[in] height - image height
+ * @param[in] bands - band layout
+ * @param[out] start - offset into index per band (count + 1 entries)
+ * @param[out] index - indices of the items crossing each band in band order
+ * @return 1 on success, 0 on allocation error
+ */
+static int sortIntoBands(const int * rows, const size_t n, const int height, const tBands * bands, size_t ** start, size_t ** index) {
+	const int bandRows = bands->rows;
+	size_t * itemStart = (size_t *)calloc((size_t)bands->count + 1, sizeof(size_t));
+	size_t * itemIndex = NULL;
+	*start = itemStart;
+	if (itemStart == NULL) return 0;
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t i = 0; i < n; i++) {
+			const int firstRow = rows[2 * i];
+			const int lastRow = rows[(2 * i) + 1];
+			if (firstRow > lastRow) continue;
+			/* band i covers the rows from height - (i + 1) * bandRows to height - i * bandRows, the top band starts at row 0 */
+			const int firstBand = (height - 1 - lastRow) / bandRows;
+			const int lastBand = (firstRow < bandRows) ? (bands->count - 1) : ((height - 1 - firstRow) / bandRows);
+			for (int band = firstBand; band <= lastBand; band++) {
+				if (pass == 0) {
+					itemStart[band + 1]++;
+				} else {
+					itemIndex[itemStart[band]++] = i;
+				}
+			}
+		}
+		if (pass == 0) {
+			for (int band = 0; band < bands->count; band++) {
+				itemStart[band + 1] += itemStart[band];
+			}
+			itemIndex = (size_t *)malloc(PCF_MAX(1, itemStart[bands->count]) * sizeof(size_t));
+			*index = itemIndex;
+			if (itemIndex == NULL) return 0;
+		}
+	}
+	/* restore the start offsets which were advanced while filling */
+	for (int band = bands->count; band > 0; band--) {
+		itemStart[band] = itemStart[band - 1];
+	}
+	itemStart[0] = 0;
+	return 1;
+}
+
+
+/**
+ * Prepares the given SVG image and scan line spans for rendering band by
+ * band. The paths are flattened once for all bands in stroke mode and sorted
+ * into the bands they cross in power mode. The spans are sorted into the
+ * bands they cross. The bands are laid out like in renderBands().
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] svg - SVG image to render
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @param[in] size - output image size
+ * @param[in] bandRows - number of rows per band
+ * @param[out] bands - prepared band data (release with releaseBands())
+ * @return 1 on success, 0 on allocation error
+ */
+static int prepareBands(tContext * ctx, NSVGimage * svg, const tSpanVec * spans, const tSettings * settings, const tSize * size, const int bandRows, tBands * bands) {
+	const NSVGshape * shape = svg->shapes;
+	const int hasPaths = (shape != NULL && shape->paths != NULL) ? 1 : 0;
+	const int hasSpans = (spans != NULL && spans->size > 0) ? 1 : 0;
+	const int height = size->height;
+	float scale = 1.0f, tx = 0.0f, ty = 0.0f;
+	int * rows;
+	int res;
+	memset(bands, 0, sizeof(*bands));
+	bands->rows = bandRows;
+	bands->count = (height + bandRows - 1) / bandRows;
+	if (hasPaths == 0 && hasSpans == 0) return 1;
+	getRenderTransform(ctx, svg, size, &tx, &ty, &scale);
+	if (hasPaths != 0 && settings->mode != RM_POWER) {
+		if (nsvgPrepareBands(ctx->rast, svg, tx, ty, scale, size->width, height, bandRows) != 1) return 0;
+		bands->hasEdges = 1;
+	}
+	/* the rows match acc_addSpan() and acc_addCubic() with one row of margin */
+	const float reach = (0.5f * settings->strokeWidth * scale) + 1.5f;
+	if (hasSpans != 0) {
+		rows = (int *)malloc(spans->size * 2 * sizeof(int));
+		if (rows == NULL) return 0;
+		for (size_t i = 0; i < spans->size; i++) {
+			const float y = (spans->data[i].y * scale) + ty;
+			rows[2 * i] = PCF_MAX(0, (int)floorf(y - reach));
+			rows[(2 * i) + 1] = PCF_MIN(height - 1, (int)floorf(y + reach));
+		}
+		res = sortIntoBands(rows, spans->size, height, bands, &(bands->spanStart), &(bands->spanIndex));
+		free(rows);
+		if (res != 1) return 0;
+	}
+	if (hasPaths != 0 && settings->mode == RM_POWER) {
+		size_t n = 0;
+		for (const NSVGpath * path = shape->paths; path != NULL; path = path->next) n++;
+		bands->paths = (const NSVGpath **)malloc(n * sizeof(NSVGpath *));
+		rows = (int *)malloc(n * 2 * sizeof(int));
+		if (bands->paths == NULL || rows == NULL) {
+			if (rows != NULL) free(rows);
+			return 0;
+		}
+		n = 0;
+		for (const NSVGpath * path = shape->paths; path != NULL; path = path->next, n++) {
+			/* the curves lie within the bounds of their control points */
+			const float * pts = getPathPoints(ctx, path);
+			float yMin = 0.0f, yMax = -1.0f;
+			for (int i = 0; i < path->npts; i++) {
+				const float y = pts[(2 * i) + 1];
+				if (i == 0 || y < yMin) yMin = y;
+				if (i == 0 || y > yMax) yMax = y;
+			}
+			bands->paths[n] = path;
+			if (path->npts < 4) {
+				/* no curve to render */
+				rows[2 * n] = 1;
+				rows[(2 * n) + 1] = 0;
+			} else {
+				rows[2 * n] = PCF_MAX(0, (int)floorf((yMin * scale) + ty - reach));
+				rows[(2 * n) + 1] = PCF_MIN(height - 1, (int)floorf((yMax * scale) + ty + reach));
+			}
+		}
+		res = sortIntoBands(rows, n, height, bands, &(bands->pathStart), &(bands->pathIndex));
+		free(rows);
+		if (res != 1) return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Releases the data allocated by prepareBands().
+ *
+ * @param[in,out] bands - prepared band data
+ */
+static void releaseBands(tBands * bands) {
+	if (bands->spanStart != NULL) free(bands->spanStart);
+	if (bands->spanIndex != NULL) free(bands->spanIndex);
+	if (bands->paths != NULL) free((void *)bands->paths);
+	if (bands->pathStart != NULL) free(bands->pathStart);
+	if (bands->pathIndex != NULL) free(bands->pathIndex);
+	bands->spanStart = NULL;
+	bands->spanIndex = NULL;
+	bands->paths = NULL;
+	bands->pathStart = NULL;
+	bands->pathIndex = NULL;
+}
+
+
+/**
+ * Renders the given SVG image and scan line spans band by band and passes
+ * the rows vertically flipped to the given PNG writer. The bands are
+ * rendered from the bottom to the top image row to match the PNG row order.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] svg - SVG image to render
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @param[in] size - output image size
+ * @param[in] bands - band data from prepareBands()
+ * @param[out] img - RGBA image band with size->width * bands->rows pixels
+ * @param[in,out] acc - accumulation buffer with the size of the band (NULL if not needed)
+ * @param[in,out] pngPtr - libpng write structure or NULL
+ * @param[in,out] enc - PNG encoder if pngPtr is NULL
+ * @return 1 on success, 0 on allocation error
+ */
+static int renderBands(tContext * ctx, NSVGimage * svg, const tSpanVec * spans, const tSettings * settings, const tSize * size, const tBands * bands, png_bytep img, tAccum * acc, png_structp pngPtr, tPngEnc * enc) {
+	const size_t stride = (size_t)size->width * 4;
+	const int bandRows = bands->rows;
+	int band = 0;
+	for (int endRow = size->height; endRow > 0; band++) {
+		/* the top band may overlap with the previous one to keep the band size */
+		const int firstRow = PCF_MAX(0, endRow - bandRows);
+		renderBand(ctx, svg, spans, settings, size, firstRow, bandRows, img, acc, 0, bands, band);
+		if (pngPtr != NULL) {
+			for (int y = endRow - 1; y >= firstRow; y--) {
+				png_write_row(pngPtr, img + ((size_t)(y - firstRow) * stride));
+			}
+		} else if (pngenc_addRows(enc, img + ((size_t)(endRow - 1 - firstRow) * stride), -(ptrdiff_t)stride, (size_t)(endRow - firstRow)) != 1) {
+			/* the whole band is compressed at once to split it between the threads */
+			return 0;
+		}
+		endRow = firstRow;
+	}
+	return 1;
+}
+
+
+/**
+ * Renders the given SVG image and scan line spans band by band and writes
+ * the rows vertically flipped with libpng to the given PNG memory buffer.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] svg - SVG image to render
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @param[in] size - output image size
+ * @param[in] bands - band data from prepareBands()
+ * @param[out] img - RGBA image band with size->width * bands->rows pixels
+ * @param[in,out] acc - accumulation buffer with the size of the band (NULL if not needed)
+ * @param[in] png - PNG memory buffer
+ * @return 1 on success
+ * @return 0 on allocation error
+ * @return -1 on PNG internal error
+ */
+static int renderBandsToLibpng(tContext * ctx, NSVGimage * svg, const tSpanVec * spans, const tSettings * settings, const tSize * size, const tBands * bands, png_bytep img, tAccum * acc, tPng * png) {
+	int res = 0;
+	png_structp pngPtr = NULL;
+	png_infop pngInfoPtr = NULL;
+
+	pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (pngPtr == NULL) goto onError;
+	pngInfoPtr = png_create_info_struct(pngPtr);
+	if (pngInfoPtr == NULL) goto onError;
+	if (setjmp(png_jmpbuf(pngPtr)) != 0) {
+		res = -1;
+		goto onError;
+	}
+	setPngHeader(pngPtr, pngInfoPtr, size, png);
+	png_write_info(pngPtr, pngInfoPtr);
+	renderBands(ctx, svg, spans, settings, size, bands, img, acc, pngPtr, NULL);
+	png_write_end(pngPtr, pngInfoPtr);
+
+	res = 1;
+onError:
+	if (pngInfoPtr != NULL) {
+		png_destroy_write_struct(&pngPtr, &pngInfoPtr);
+	} else if (pngPtr != NULL) {
+		png_destroy_write_struct(&pngPtr, NULL);
+	}
+	return res;
+}
+
+
+/**
+ * Renders the given SVG image and scan line spans band by band and writes
+ * the rows vertically flipped to the given PNG memory buffer. Only a single
+ * band of at most RENDER_BAND_PIXELS pixels is held in memory.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] svg - SVG image to render
+ * @param[in] spans - horizontal scan line spans to render (may be NULL)
+ * @param[in] settings - user settings
+ * @param[in] size - output image size
+ * @param[in] png - PNG memory buffer
+ * @return 1 on success
+ * @return 0 on allocation error
+ * @return -1 on PNG internal error
+ */
+static int renderToPng(tContext * ctx, NSVGimage * svg, const tSpanVec * spans, const tSettings * settings, const tSize * size, tPng * png) {
+	int res = 0;
+	tAccum * acc = NULL;
+	tBands bands;
+	const size_t stride = (size_t)size->width * 4;
+	const int bandRows = (int)PCF_MAX(1, PCF_MIN((size_t)size->height, RENDER_BAND_PIXELS / (size_t)size->width));
+	memset(&bands, 0, sizeof(bands));
+	png_bytep img = (png_bytep)malloc(stride * (size_t)bandRows);
+	if (img == NULL) goto onError;
+	if (needsAccum(spans, settings) != 0) {
+		acc = acc_create(size->width, bandRows);
+		if (acc == NULL) goto onError;
+	}
+	if (prepareBands(ctx, svg, spans, settings, size, bandRows, &bands) != 1) goto onError;
+
+	if (settings->encoder != PE_LIBPNG) {
+		tPngEnc * enc = startPng(ctx, settings, size);
+		if (enc != NULL && renderBands(ctx, svg, spans, settings, size, &bands, img, acc, NULL, enc) == 1) {
+			res = finishPng(enc, png);
+		}
+	} else {
+		res = renderBandsToLibpng(ctx, svg, spans, settings, size, &bands, img, acc, png);
+	}
+onError:
+	releaseBands(&bands);
+	acc_delete(acc);
+	if (img != NULL) free(img);
+	return res;
+}
+
+
+/**
+ * Returns the number of times the given source size needs to be halved
+ * to match the passed destination size.
+ *
+ * @param[in] src - source size
+ * @param[in] dst - destination size
+ * @return number of halving steps or 0 if not reachable
+ */
+static int getMipLevel(const tSize * src, const tSize * dst) {
+	for (int level = 1; (dst->width << level) <= src->width; level++) {
+		if ((dst->width << level) == src->width && (dst->height << level) == src->height) {
+			return level;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Creates a downsampled copy of the given image by halving its size
+ * the given number of times.
+ *
+ * @param[in] src - source RGBA image
+ * @param[in] size - source image size
+ * @param[in] level - number of halving steps
+ * @return created image or NULL on allocation error
+ */
+static png_bytep downsampleImage(const png_bytep src, const tSize * size, const int level) {
+	size_t w = (size_t)size->width;
+	size_t h = (size_t)size->height;
+	png_bytep img = (png_bytep)malloc((w / 2) * (h / 2) * 4);
+	if (img == NULL) return NULL;
+	/* each step is performed in-place after the first one */
+	simd_downsample2x(img, src, w, h);
+	for (int i = 1; i < level; i++) {
+		w /= 2;
+		h /= 2;
+		simd_downsample2x(img, img, w, h);
+	}
+	return img;
+}
+
+
+/**
+ * Determines the order in which the thumbnail sizes are rendered. Larger
+ * sizes come first. A size is downsampled from the nearest larger size if
+ * possible instead of rendering it. Band rendered sizes cannot be
+ * downsampled.
+ *
+ * @param[in] settings - user settings
+ * @param[out] order - size indices in render order
+ * @param[out] src - size index to downsample from for each size
+ * @param[out] level - number of halving steps for each size (0 to render it)
+ */
+static void planRender(const tSettings * settings, size_t * order, size_t * src, int * level) {
+	int done[MAX_THUMBNAILS] = {0};
+	for (size_t n = 0; n < settings->sizeCount; n++) {
+		size_t i = settings->sizeCount;
+		for (size_t j = 0; j < settings->sizeCount; j++) {
+			const tSize * size = settings->size + j;
+			if (done[j] != 0) {
+				continue;
+			}
+			if (i >= settings->sizeCount || (size->width * size->height) > (settings->size[i].width * settings->size[i].height)) {
+				i = j;
+			}
+		}
+		/* find the nearest larger image which can be downsampled */
+		src[i] = settings->sizeCount;
+		level[i] = 0;
+		for (size_t j = 0; j < settings->sizeCount; j++) {
+			/* band rendered sizes are never held in memory as a whole */
+			const int l = (done[j] != 0 && isBanded(settings->size + j) == 0) ? getMipLevel(settings->size + j, settings->size + i) : 0;
+			if (l > 0 && (level[i] == 0 || l < level[i])) {
+				src[i] = j;
+				level[i] = l;
+			}
+		}
+		order[n] = i;
+		done[i] = 1;
+	}
+}
+
+
+/**
+ * Render thread function. Accumulates the queued paths and spans until the
+ * queue is closed.
+ *
+ * @param[in,out] arg - pipeline state
+ */
+static void pipelineWorker(void * arg) {
+	tPipeline * pipe = (tPipeline *)arg;
+	const tSettings * settings = pipe->settings;
+	tPipeItem item;
+	while (ring_pop(pipe->ring, &item) == 1) {
+		if (item.path == NULL) {
+			for (size_t i = 0; i < settings->sizeCount; i++) {
+				if (pipe->acc[i] != NULL) accumulateSpan(pipe->acc[i], &(item.span), settings);
+			}
+			continue;
+		}
+		const NSVGpath * path = &(item.path->path);
+		const float * pts = path->pts;
+		if (item.path->code != NULL) {
+			/* the scratch buffer of the context belongs to the parser thread */
+			const size_t size = 2 * (size_t)path->npts * sizeof(float);
+			if (size > pipe->pointsSize) {
+				float * newPoints = (float *)realloc(pipe->points, size);
+				if (newPoints == NULL) {
+					pipe->failed = 1;
+					continue;
+				}
+				pipe->points = newPoints;
+				pipe->pointsSize = size;
+			}
+			cp_decodePath(pipe->points, item.path->code, (size_t)path->npts, item.path->origin[0], item.path->origin[1]);
+			pts = pipe->points;
+		}
+		for (size_t i = 0; i < settings->sizeCount; i++) {
+			if (pipe->acc[i] != NULL) accumulatePath(pipe->acc[i], path, pts);
+		}
+	}
+}
+
+
+/**
+ * Starts the render thread. The image bounds need to be set before. An
+ * accumulation buffer is created for each size which is neither downsampled
+ * from a larger one nor rendered band by band. The items are rendered
+ * sequentially if no thread can be created.
+ *
+ * @param[in] ctx - processing context
+ * @param[in] svg - SVG image with valid width and height
+ * @param[in] settings - user settings
+ * @param[out] pipe - pipeline state (needs to be zero initialized)
+ * @return 1 on success, 0 on allocation error
+ */
+static int startPipeline(const tContext * ctx, const NSVGimage * svg, const tSettings * settings, tPipeline * pipe) {
+	size_t order[MAX_THUMBNAILS];
+	size_t src[MAX_THUMBNAILS];
+	int level[MAX_THUMBNAILS];
+	planRender(settings, order, src, level);
+	pipe->settings = settings;
+	for (size_t i = 0; i < settings->sizeCount; i++) {
+		float tx, ty, scale;
+		if (level[i] > 0 || isBanded(settings->size + i) != 0) continue;
+		pipe->acc[i] = acc_create(settings->size[i].width, settings->size[i].height);
+		if (pipe->acc[i] == NULL) return 0;
+		getRenderTransform(ctx, svg, settings->size + i, &tx, &ty, &scale);
+		acc_setTransform(pipe->acc[i], tx, ty, scale, settings->strokeWidth);
+	}
+	pipe->ring = ring_create(0, sizeof(tPipeItem));
+	if (pipe->ring == NULL) return 0;
+	pipe->thread = thread_create(pipelineWorker, pipe);
+	if (pipe->thread == NULL) {
+		/* fall back to sequential rendering */
+		for (size_t i = 0; i < settings->sizeCount; i++) {
+			acc_delete(pipe->acc[i]);
+			pipe->acc[i] = NULL;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * Passes the given completed path to the render thread. Only the power
+ * render mode accumulates paths. The stroke render mode rasterizes them
+ * after parsing.
+ *
+ * @param[in,out] pipe - pipeline state
+ * @param[in] path - completed path
+ */
+static void pipePath(tPipeline * pipe, const NSVGpath * path) {
+	tPipeItem item;
+	if (pipe->thread == NULL || pipe->settings->mode != RM_POWER) return;
+	memset(&item, 0, sizeof(item));
+	item.path = (const tPath *)path;
+	ring_push(pipe->ring, &item);
+}
+
+
+/**
+ * Makes room for the given number of points of the current path in the
+ * passed point vector. The current path is completed and continued as new
+ * path from its last point if the current chunk is too small. Hence, points
+ * are never copied or moved to grow a path.
+ *
+ * @param[in,out] ctx - processing context
+ * @param[in] settings - user settings
+ * @param[in,out] pipe - pipeline state
+ * @param[in,out] pathPtr - pointer to previous path handle (updated if split)
+ * @param[in,out] points - point vector with the current path
+ * @param[in] power - laser power of the current path in percent
+ * @param[in] count - number of points to add
+ * @return 1 on success, else 0 on allocation error
+ */
+static int splitPath(tContext * ctx, const tSettings * settings, tPipeline * pipe, NSVGpath *** pathPtr, tPointVec * points, const float power, const size_t count) {
+	if ((points->size + count) <= points->capacity || (points->size - points->start) <= 1) {
+		/* fits or only the start point which growPointVec() carries over */
+		return 1;
+	}
+	const float * last = points->data + (2 * (points->size - 1));
+	const float x = last[0];
+	const float y = last[1];
+	NSVGpath * path = pointsToPath(ctx, settings, *pathPtr, points, power);
+	if (path == NULL) return 0;
+	((tPath *)path)->caps &= ~ACCUM_CAP_END;
+	points->isContinued = 1;
+	pipePath(pipe, path);
+	*pathPtr = &(path->next);
+	if ((points->size + 1 + count) > points->capacity) {
+		/* start the next chunk (compact encoding may have freed enough space already) */
+		points->start = points->capacity;
+		points->size = points->capacity;
+	}
+	return (addPoint(points, x, y) != NULL) ? 1 : 0;
+}
+
+
+/**
+ * Passes the completed spans to the render thread. A span is completed once
+ * its caps are final.
+ *
+ * @param[in,out] pipe - pipeline state
+ * @param[in] spans - span vector
+ * @param[in] count - number of completed spans in the span vector
+ */
+static void pipeSpans(tPipeline * pipe, const tSpanVec * spans, const size_t count) {
+	tPipeItem item;
+	if (pipe->thread == NULL || spans == NULL) return;
+	memset(&item, 0, sizeof(item));
+	for (; pipe->spanCount < count; pipe->spanCount++) {
+		item.span = spans->data[pipe->spanCount];
+		ring_push(pipe->ring, &item);
+	}
+}
+
+
+/**
+ * Waits for the render thread to finish all queued items and releases the
+ * pipeline resources except the accumulation buffers.
+ *
+ * @param[in,out] pipe - pipeline state
+ * @return 1 on success, 0 if the render thread failed to allocate memory
+ */
+static int finishPipeline(tPipeline * pipe) {
+	if (pipe->thread != NULL) {
+		ring_close(pipe->ring);
+		thread_join(pipe->thread);
+		pipe->thread = NULL;
+	}
+	ring_delete(pipe->ring);
+	pipe->ring = NULL;
+	if (pipe->points != NULL) free(pipe->points);
+	pipe->points = NULL;
+	pipe->pointsSize = 0;
+	return (pipe->failed == 0) ? 1 : 0;
+}
+
+
+/**
+ * Returns the output file path for the given additional thumbnail size.
+ * The extension of the input file path is replaced by "-<w>x<h>.png".
+ *
+ * @param[in] file - input file path
+ * @param[in] size - thumbnail size
+ * @return allocated file path or NULL on allocation error
+ */
+static TCHAR * getThumbnailPath(const TCHAR * file, const tSize * size) {
+	static const size_t suffixLen = 32;
+	if (io_isStdio(file) != 0) file = _T("stdin");
+	const TCHAR * sep = _tcsrpbrk(file, _T("/\\"));
+	const TCHAR * ext = _tcsrchr((sep != NULL) ? sep : file, _T('.'));
+	const size_t len = (ext != NULL) ? (size_t)(ext - file) : _tcslen(file);
+	TCHAR * path = (TCHAR *)malloc((len + suffixLen) * sizeof(TCHAR));
+	if (path == NULL) return NULL;
+	memcpy(path, file, len * sizeof(TCHAR));
+	_sntprintf(path + len, suffixLen, _T("-%ix%i.png"), size->width, size->height);
+	return path;
+}
+
+
+/**
+ * Writes the given PNG data to the passed file.
+ *
+ * @param[in] file - output file path
+ * @param[in] png - PNG data
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+static int writePngFile(const TCHAR * file, const tPng * png, const tCallback cb) {
+	tIoSegment data;
+	data.data = png->data;
+	data.size = png->size;
+	switch (io_writeFile(file, &data, 1)) {
+	case IO_OK:
+		return 1;
+	case IO_ERR_CREATE:
+		cb(MSGT_ERR_FILE_CREATE, file, 0);
+		break;
+	default:
+		cb(MSGT_ERR_FILE_WRITE, file, 0);
+		break;
+	}
+	return 0;
+}
+
+
+/**
+ * Returns the thumbnail cache file path for the given hash and thumbnail size.
+ * The file name is "<hash>-<w>x<h>.png" within the given directory. Temporary
+ * file names get a ".<pid>-<n>.tmp" suffix which is unique among concurrent
+ * runs.
+ *
+ * @param[in] dir - cache directory
+ * @param[in] hash - hash of the G-Code and settings
+ * @param[in] size - thumbnail size
+ * @param[in] isTemp - set to 1 to get a unique temporary file name
+ * @return allocated file path or NULL on allocation error
+ */
+static TCHAR * getCachePath(const TCHAR * dir, const uint64_t hash, const tSize * size, const int isTemp) {
+	static const size_t suffixLen = 96;
+	static unsigned long tempCount = 0;
+	TCHAR tempSuffix[48] = {0};
+	if (isTemp != 0) {
+		_sntprintf(tempSuffix, 47, _T(".%lu-%lu.tmp"), thread_processId(), tempCount++);
+	}
+	size_t len = _tcslen(dir);
+	TCHAR * path = (TCHAR *)malloc((len + suffixLen) * sizeof(TCHAR));
+	if (path == NULL) return NULL;
+	memcpy(path, dir, len * sizeof(TCHAR));
+	if (len > 0 && _tcschr(_T("/\\"), dir[len - 1]) == NULL) {
+		path[len++] = _T('/');
+	}
+	_sntprintf(
+		path + len,
+		suffixLen,
+		_T("%08lx%08lx-%ix%i.png%s"),
+		(unsigned long)(hash >> 32),
+		(unsigned long)(hash & 0xFFFFFFFFUL),
+		size->width,
+		size->height,
+		tempSuffix
+	);
+	return path;
+}
+
+
+/**
+ * Checks whether the given data starts with the PNG signature and ends with
+ * the IEND chunk. This detects truncated or otherwise incomplete files.
+ *
+ * @param[in] data - PNG data
+ * @param[in] size - size of the PNG data in bytes
+ * @return 1 if complete, else 0
+ */
+static int isCompletePng(const unsigned char * data, const size_t size) {
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	static const unsigned char iend[12] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+	if (data == NULL || size < (sizeof(signature) + sizeof(iend))) return 0;
+	if (memcmp(data, signature, sizeof(signature)) != 0) return 0;
+	return (memcmp(data + size - sizeof(iend), iend, sizeof(iend)) == 0) ? 1 : 0;
 }
 
 
 /**
- * Clamps and converts the given float to a valid
- * color value. The value range is 0..255.
+ * Reads the PNG data from the passed file. Incomplete PNG files are rejected.
  *
- * @param[in] val - value to convert
- * @return converted value
+ * @param[in] file - input file path
+ * @param[out] png - PNG data (allocated)
+ * @return 1 on success, 0 on failure
  */
-static unsigned char toColor(const float val) {
-	if (val > 255.0f) {
-		return 255;
-	} else if (val < 0.0f) {
+static int readPngFile(const TCHAR * file, tPng * png) {
+	char * data = NULL;
+	if (io_readFile(file, &data, &(png->size)) != IO_OK || data == NULL) {
+		png->size = 0;
+		return 0;
+	}
+	if (isCompletePng((const unsigned char *)data, png->size) != 1) {
+		free(data);
+		png->size = 0;
 		return 0;
-	} else {
-		return (unsigned char)val;
 	}
+	png->data = (png_bytep)data;
+	return 1;
 }
 
 
 /**
- * Blends the pixel with the given color according to the
- * alpha value of the pixel. All color values are RGBA.
+ * Checks whether the given file is a complete PNG file.
  *
- * @param[in,out] pixel - pixel to blend (modified in-place)
- * @param[in] color - color to blend with
+ * @param[in] file - file path
+ * @return 1 if complete, else 0
  */
-static void blendByAlpha(unsigned char * pixel, unsigned int color) {
-	const float a = ((float)pixel[3]) / 255.0f;
-	for (size_t i = 0; i < 3; i++) {
-		float x = (float)(unsigned char)(color >> (8 * i));
-		float y = (float)(*pixel);
-		*pixel++ = toColor(x + ((y - x) * a) + 0.5f);
-	}
-	*pixel = 255; /* opaque */
+static int hasPngFile(const TCHAR * file) {
+	tPng png;
+	memset(&png, 0, sizeof(png));
+	if (readPngFile(file, &png) != 1) return 0;
+	free(png.data);
+	return 1;
 }
 
 
 /**
- * Adds the given PNG data block to the associated PNG object.
+ * Loads all thumbnails for the given hash from the cache.
  *
- * @param[in] pngPtr - context
- * @param[in] data - data to add
- * @param[in] length - data length in number of bytes
+ * @param[in] settings - user settings
+ * @param[in] hash - hash of the G-Code and settings
+ * @param[out] png - PNG data for each thumbnail size
+ * @return 1 on cache hit, 0 on cache miss and -1 on allocation error
  */
-static void pngWriteData(png_structp pngPtr, png_bytep data, png_size_t length) {
-	tPng * png = (tPng *)png_get_io_ptr(pngPtr);
-	size_t newSize = png->size + length;
-	if (png->data != NULL) {
-		png->data = (png_bytep)realloc(png->data, newSize);
-	} else {
-		png->data = (png_bytep)malloc(newSize);
+static int loadCachedPngs(const tSettings * settings, const uint64_t hash, tPng * png) {
+	int res = 1;
+	for (size_t i = 0; res == 1 && i < settings->sizeCount; i++) {
+		TCHAR * path = getCachePath(settings->cacheDir, hash, settings->size + i, 0);
+		if (path == NULL) {
+			res = -1;
+		} else if (readPngFile(path, png + i) != 1) {
+			res = 0;
+		}
+		if (path != NULL) free(path);
 	}
-	if (png->data == NULL) {
-		png_error(pngPtr, "Failed to allocate memory.");
+	if (res != 1) {
+		/* all or nothing */
+		for (size_t i = 0; i < settings->sizeCount; i++) {
+			if (png[i].data != NULL) free(png[i].data);
+			png[i].data = NULL;
+			png[i].size = 0;
+		}
 	}
-	memcpy(png->data + png->size, data, length);
-	png->size = newSize;
+	return res;
 }
 
 
 /**
- * Writes the passed image rows to the given PNG memory buffer.
+ * Stores all thumbnails for the given hash in the cache. Each file is
+ * written to a temporary file with a name unique to this run first and
+ * renamed afterwards to not leave incomplete files behind. A complete file
+ * which already exists (e.g. from a concurrent run) is kept as is.
  *
- * @param[in] imgRows - image row pointers
- * @param[in] png - PNG memory buffer
- * @return 1 on success
- * @return 0 on allocation error
- * @return -1 on PNG internal error
+ * @param[in] settings - user settings
+ * @param[in] hash - hash of the G-Code and settings
+ * @param[in] png - PNG data for each thumbnail size
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
  */
-static int imgToPng(png_bytepp imgRows, tPng * png) {
-	int res = 0;
-	png_structp pngPtr = NULL;
-	png_infop pngInfoPtr = NULL;
-
-	pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (pngPtr == NULL) goto onError;
-	pngInfoPtr = png_create_info_struct(pngPtr);
-	if (pngInfoPtr == NULL) goto onError;
-	if (setjmp(png_jmpbuf(pngPtr)) != 0) {
-		res = -1;
-		goto onError;
-	}
-	png_set_IHDR(
-		pngPtr, pngInfoPtr, IMAGE_WIDTH, IMAGE_HEIGHT, 8, PNG_COLOR_TYPE_RGB_ALPHA,
-		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE
-	);
-	png_set_rows(pngPtr, pngInfoPtr, imgRows);
-	png_set_write_fn(pngPtr, png, &pngWriteData, NULL);
-	png_write_png(pngPtr, pngInfoPtr, PNG_TRANSFORM_IDENTITY, NULL);
-
-	res = 1;
-onError:
-	if (pngInfoPtr != NULL) {
-		png_destroy_write_struct(&pngPtr, &pngInfoPtr);
-	} else if (pngPtr != NULL) {
-		png_destroy_write_struct(&pngPtr, NULL);
+static int storeCachedPngs(const tSettings * settings, const uint64_t hash, const tPng * png, const tCallback cb) {
+	int res = 1;
+	for (size_t i = 0; res == 1 && i < settings->sizeCount; i++) {
+		TCHAR * tmpPath = getCachePath(settings->cacheDir, hash, settings->size + i, 1);
+		TCHAR * path = getCachePath(settings->cacheDir, hash, settings->size + i, 0);
+		if (tmpPath == NULL || path == NULL) {
+			res = 0;
+		} else if (hasPngFile(path) == 1) {
+			/* already cached */
+		} else if (writePngFile(tmpPath, png + i, cb) != 1) {
+			_tremove(tmpPath);
+			res = 0;
+		} else if (_trename(tmpPath, path) != 0) {
+			/* the target exists (rename does not replace files on Windows) */
+			if (hasPngFile(path) != 1) {
+				/* replace an incomplete file */
+				_tremove(path);
+				if (_trename(tmpPath, path) != 0) res = 0;
+			}
+			_tremove(tmpPath);
+		}
+		if (tmpPath != NULL) free(tmpPath);
+		if (path != NULL) free(path);
 	}
 	return res;
 }
@@ -495,25 +2138,25 @@ onError:
 
 /**
  * Writes the given memory block Base64 encoded to the passed
- * file descriptor.
+ * output buffer.
  *
- * @param[in,out] fp - file descriptor to write to
+ * @param[out] out - output buffer with at least BASE64_SIZE(size) bytes
  * @param[in] data - pointer to the input data
  * @param[in] size - number of bytes in the given input data
+ * @return number of bytes written
  */
-static void writeBase64(FILE * fp, const unsigned char * data, const size_t size) {
+static size_t encodeBase64(char * out, const unsigned char * data, const size_t size) {
 	static char table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 	const unsigned char * inPtr;
 	const unsigned char * endPtr;
-	char buf[4];
+	char * buf = out;
 
 	endPtr = data + size;
-	for (inPtr = data; (inPtr + 3) <= endPtr; inPtr += 3) {
+	for (inPtr = data; (inPtr + 3) <= endPtr; inPtr += 3, buf += 4) {
 		buf[0] = table[inPtr[0] >> 2];
 		buf[1] = table[((inPtr[0] & 0x03) << 4) | (inPtr[1] >> 4)];
 		buf[2] = table[((inPtr[1] & 0x0F) << 2) | (inPtr[2] >> 6)];
 		buf[3] = table[inPtr[2] & 0x3F];
-		fwrite(buf, sizeof(buf), 1, fp);
 	}
 
 	if (inPtr < endPtr) {
@@ -526,21 +2169,227 @@ static void writeBase64(FILE * fp, const unsigned char * data, const size_t size
 			buf[2] = table[(inPtr[1] & 0x0F) << 2];
 		}
 		buf[3] = '=';
-		fwrite(buf, sizeof(buf), 1, fp);
+		buf += 4;
+	}
+	return (size_t)(buf - out);
+}
+
+
+/**
+ * Locates the header lines handled by sm2lbpp within the leading comment
+ * block of the given G-Code. Only the first occurrence of each line is
+ * recorded. The work area bounds are read as well if all of them are given.
+ *
+ * @param[in] buf - G-Code
+ * @param[in] len - number of bytes in buf
+ * @param[out] hdr - found header lines
+ */
+static void scanHeader(const char * buf, const size_t len, tHeader * hdr) {
+	static const char * keys[HL_COUNT] = {
+		/* HL_POST_PROCESSED */ "post-processed by sm2lbpp", /* prefix */
+		/* HL_TOTAL_LINES    */ "file_total_lines",
+		/* HL_THUMBNAIL      */ "thumbnail",
+		/* HL_HASH           */ "sm2lbpp_hash"
+	};
+	static const char * boundKeys[4] = {"min_x(mm)", "min_y(mm)", "max_x(mm)", "max_y(mm)"};
+	const char * endPtr = buf + len;
+	int foundBounds = 0;
+	memset(hdr, 0, sizeof(*hdr));
+	for (const char * line = buf, * next = buf; line < endPtr; line = next) {
+		const char * eol = (const char *)memchr(line, '\n', (size_t)(endPtr - line));
+		const char * it = line;
+		tPToken key;
+		tPToken value = {0};
+		next = (eol != NULL) ? (eol + 1) : endPtr;
+		if (eol == NULL) eol = endPtr;
+		for (; it < eol && isspace((unsigned char)(*it)) != 0; it++);
+		if (it >= eol) continue; /* empty line */
+		if (*it != ';') break; /* end of the leading comment block */
+		for (it++; it < eol && isspace((unsigned char)(*it)) != 0; it++);
+		key.start = it;
+		for (; it < eol && *it != ':'; it++);
+		key.length = (size_t)(it - key.start);
+		for (; key.length > 0 && isspace((unsigned char)(key.start[key.length - 1])) != 0; key.length--);
+		if (it < eol) {
+			/* trimmed value after the colon */
+			for (it++; it < eol && isspace((unsigned char)(*it)) != 0; it++);
+			value.start = it;
+			value.length = (size_t)(eol - it);
+			for (; value.length > 0 && isspace((unsigned char)(it[value.length - 1])) != 0; value.length--);
+		}
+		for (int i = 0; value.start != NULL && i < 4; i++) {
+			if (p_cmpToken(&key, boundKeys[i]) == 0) {
+				hdr->bounds[i] = p_float(&value);
+				foundBounds |= 1 << i;
+			}
+		}
+		for (int i = 0; i < HL_COUNT; i++) {
+			if (hdr->line[i].start != NULL) continue;
+			if (i == HL_POST_PROCESSED) {
+				const size_t keyLen = strlen(keys[i]);
+				if (key.length < keyLen || strncmp(key.start, keys[i], keyLen) != 0) continue;
+			} else if (value.start == NULL || p_cmpToken(&key, keys[i]) != 0) {
+				continue;
+			}
+			hdr->line[i].start = line;
+			hdr->line[i].length = (size_t)(next - line);
+			if (i != HL_POST_PROCESSED) {
+				hdr->value[i] = value;
+			}
+			break;
+		}
+	}
+	if (foundBounds == 0xF && hdr->bounds[2] > hdr->bounds[0] && hdr->bounds[3] > hdr->bounds[1]) {
+		hdr->hasBounds = 1;
+	}
+}
+
+
+/**
+ * Counts the lines of the given G-Code the same way the G-Code state machine
+ * does (i.e. the number of line breaks plus one).
+ *
+ * @param[in] buf - G-Code
+ * @param[in] len - number of bytes in buf
+ * @return number of lines
+ */
+static size_t countLines(const char * buf, const size_t len) {
+	return simd_countChar(buf, len, '\n') + 1;
+}
+
+
+/**
+ * Returns the header line which starts first at or after the given position.
+ *
+ * @param[in] hdr - header lines
+ * @param[in] pos - start position
+ * @return header line index or HL_COUNT if there is none
+ */
+static int nextHeaderLine(const tHeader * hdr, const char * pos) {
+	int res = HL_COUNT;
+	for (int i = 0; i < HL_COUNT; i++) {
+		if (hdr->line[i].start == NULL || hdr->line[i].start < pos) continue;
+		if (res >= HL_COUNT || hdr->line[i].start < hdr->line[res].start) res = i;
+	}
+	return res;
+}
+
+
+/**
+ * Calculates the hash of the given G-Code without the header lines handled
+ * by sm2lbpp. The program version and all settings which change the output
+ * are part of the hash. This includes whether the image bounds are taken from
+ * the header in pipeline mode, as these may differ from the measured bounds.
+ * A changed hash means that the thumbnail is outdated.
+ *
+ * @param[in] buf - G-Code
+ * @param[in] len - number of bytes in buf
+ * @param[in] hdr - header lines to exclude
+ * @param[in] settings - user settings
+ * @return hash value
+ */
+static uint64_t hashBody(const char * buf, const size_t len, const tHeader * hdr, const tSettings * settings) {
+	const char * endPtr = buf + len;
+	const int headerBounds = (settings->pipeline != 0 && hdr->hasBounds != 0) ? 1 : 0;
+	tHash h;
+	hash_init(&h, 0);
+	hash_update(&h, PROGRAM_VERSION_STR, strlen(PROGRAM_VERSION_STR));
+	hash_update(&h, &(settings->sizeCount), sizeof(settings->sizeCount));
+	hash_update(&h, settings->size, settings->sizeCount * sizeof(tSize));
+	hash_update(&h, &(settings->strokeWidth), sizeof(settings->strokeWidth));
+	hash_update(&h, &(settings->borderWidth), sizeof(settings->borderWidth));
+	hash_update(&h, &(settings->borderHeight), sizeof(settings->borderHeight));
+	hash_update(&h, &(settings->backgroundColor), sizeof(settings->backgroundColor));
+	hash_update(&h, &(settings->strokeColor), sizeof(settings->strokeColor));
+	hash_update(&h, &(settings->mode), sizeof(settings->mode));
+	hash_update(&h, &(settings->compact), sizeof(settings->compact));
+	hash_update(&h, &(settings->pipeline), sizeof(settings->pipeline));
+	hash_update(&h, &headerBounds, sizeof(headerBounds));
+	for (const char * it = buf; it < endPtr; ) {
+		const int i = nextHeaderLine(hdr, it);
+		const char * next = (i < HL_COUNT) ? hdr->line[i].start : endPtr;
+		hash_update(&h, it, (size_t)(next - it));
+		if (i >= HL_COUNT) break;
+		it = next + hdr->line[i].length;
+	}
+	return hash_final(&h);
+}
+
+
+/**
+ * Writes the header lines generated by sm2lbpp which follow the line with
+ * the post-processing note to the given output buffer.
+ *
+ * @param[out] out - output buffer with at least HEADER_LINES_SIZE(png->size) bytes
+ * @param[in] totalLines - total number of lines of the output file
+ * @param[in] png - PNG image to embed
+ * @param[in] hash - formatted hash value of the input file
+ * @return number of bytes written
+ */
+static size_t formatHeaderLines(char * out, const size_t totalLines, const tPng * png, const char * hash) {
+	static const char thumbnailKey[] = ";thumbnail: data:image/png;base64,";
+	char * buf = out;
+	/* output corrected line count */
+	buf += sprintf(buf, ";file_total_lines: %lu\n", (unsigned long)totalLines);
+	/* output base64 encoded PNG of the preview image */
+	memcpy(buf, thumbnailKey, sizeof(thumbnailKey) - 1);
+	buf += sizeof(thumbnailKey) - 1;
+	buf += encodeBase64(buf, (const unsigned char *)(png->data), png->size);
+	*buf++ = '\n';
+	/* output hash to detect outdated thumbnails */
+	buf += sprintf(buf, ";sm2lbpp_hash: %s\n", hash);
+	return (size_t)(buf - out);
+}
+
+
+/**
+ * Creates a new processing context.
+ *
+ * @return created context or NULL on allocation error
+ */
+tContext * createContext(void) {
+	tContext * ctx = (tContext *)malloc(sizeof(tContext));
+	if (ctx == NULL) return NULL;
+	memset(ctx, 0, sizeof(tContext));
+	ctx->arena = arena_create(0);
+	if (ctx->arena == NULL) {
+		free(ctx);
+		return NULL;
 	}
+	return ctx;
+}
+
+
+/**
+ * Deletes the given processing context and all objects owned by it.
+ *
+ * @param[in,out] ctx - context to delete
+ */
+void deleteContext(tContext * ctx) {
+	if (ctx == NULL) return;
+	if (ctx->rast != NULL) nsvgDeleteRasterizer(ctx->rast);
+	pngenc_delete(ctx->pngEnc);
+	if (ctx->spans != NULL) deleteSpanVec(ctx->spans);
+	if (ctx->scratch != NULL) free(ctx->scratch);
+	arena_delete(ctx->arena);
+	free(ctx);
 }
 
 
 /**
  * Processes the given LightBurn generated G-Code file and adds
- * Snapmaker 2.0 terminal compatible thumbnail data.
+ * Snapmaker 2.0 terminal compatible thumbnail data. All objects created
+ * for the file are allocated from the given context and are released on
+ * return or reused by the next call.
  *
+ * @param[in,out] ctx - processing context
  * @param[in] file - LightBurn generated G-Code file
+ * @param[in] settings - user settings
  * @param[in] cb - error output callback function
  * @return 1 on success, 0 on failure, -1 if aborted by callback function
  * @see https://github.com/Snapmaker/Snapmaker2-Controller/blob/main/snapmaker/src/gcode/M3-M5.cpp#L66-L69
  */
-int processFile(const TCHAR * file, const tCallback cb) {
+int processFile(tContext * ctx, const TCHAR * file, const tSettings * settings, const tCallback cb) {
 #define ON_WARN(msg) do { \
 	if (cb(msg, file, lineNr) != 1) goto onError; \
 } while (0) \
@@ -552,19 +2401,31 @@ int processFile(const TCHAR * file, const tCallback cb) {
 #define GCODE(type, num) (((unsigned int)(type) << 16) | (unsigned int)(num))
 #define IS_SET(num) ((num) == (num))
 
-	if (file == NULL || cb == NULL) return 0;
+	if (ctx == NULL || file == NULL || settings == NULL || settings->sizeCount < 1 || cb == NULL) return 0;
 	int res = 0;
 	int pwrOn = 0;
 	int prevOn = 0;
 	int isAbsPos = 1;
+	int inSpan = 0;
+	size_t runStart = 0;
+	int isArc = 0;
 	unsigned int code = -1;
+	unsigned int moveCode = -1;
 	float paramX = NAN;
 	float paramY = NAN;
 	float paramP = NAN;
+	float paramI = NAN;
+	float paramJ = NAN;
+	float paramR = NAN;
 	float paramS = NAN;
 	float x = NAN;
 	float y = NAN;
+	float prevX = NAN;
+	float prevY = NAN;
+	float arcX = NAN;
+	float arcY = NAN;
 	float pwr = 0.0f;
+	float pathPwr = 0.0f;
 	float minX = +INFINITY;
 	float minY = +INFINITY;
 	float maxX = -INFINITY;
@@ -572,80 +2433,114 @@ int processFile(const TCHAR * file, const tCallback cb) {
 	size_t lineNr = 1;
 	char * inputBuf = NULL;
 	size_t inputLen = 0;
-	FILE * fp = NULL;
+	int isWritten = 0; /* output file written or queued */
+	tIoJob job;
 	NSVGimage * svg = NULL;
 	NSVGshape * shape = NULL;
 	NSVGpath * path = NULL;
 	NSVGpath ** pathPtr = NULL;
-	tPointVec * pointVec = NULL;
-	NSVGrasterizer * rast = NULL;
-	png_bytep img = NULL;
-	png_bytepp imgRows = NULL;
-	tPng png = {0};
-	tPToken totalLines = {0};
-	tPToken totalLinesLine = {0};
+	tPointVec points;
+	tPointVec * pointVec = &points;
+	tSpanVec * spans = ctx->spans;
+	png_bytep img[MAX_THUMBNAILS] = {0};
+	tPng png[MAX_THUMBNAILS] = {{0}};
+	TCHAR * pngFile = NULL;
+	tHeader header;
+	tPipeline pipe;
+	int isPipelined = 0;
+	size_t renderOrder[MAX_THUMBNAILS];
+	size_t renderSrc[MAX_THUMBNAILS];
+	int renderLevel[MAX_THUMBNAILS];
+	uint64_t hash = 0;
+	char hashStr[HASH_STR_LEN + 1];
+	size_t totalLines = 0;
 	tPToken aToken = {0};
-	tPToken * valueToken = NULL;
-	const char * lineStart = NULL;
 	enum tState {
 		ST_LINE_START,
 		ST_FIND_LINE_START,
-		ST_GCODE,
-		ST_COMMENT,
-		ST_PARAMETER_VALUE
+		ST_GCODE
 	} state = ST_LINE_START;
 #ifdef DEBUG
 	static const TCHAR * stateStr[] = {
 		_T("ST_LINE_START"),
 		_T("ST_FIND_LINE_START"),
-		_T("ST_GCODE"),
-		_T("ST_COMMENT"),
-		_T("ST_PARAMETER_VALUE")
+		_T("ST_GCODE")
 	};
 #endif /* DEBUG */
-	enum tParam {
-		P_G,
-		P_M,
-		P_X,
-		P_Y,
-		P_P,
-		P_S,
-		P_UNKNOWN
-	} param = P_UNKNOWN;
+	tParam param = P_UNKNOWN;
+	unsigned int numClass = CC_DIGIT; /* character classes of the current parameter value */
+
+	/* release all objects of the previous file */
+	memset(&pipe, 0, sizeof(pipe));
+	memset(&job, 0, sizeof(job));
+	arena_reset(ctx->arena);
+	memset(&points, 0, sizeof(points));
+	points.arena = ctx->arena;
+	if (spans != NULL) {
+		spans->size = 0;
+	}
 
 	/* initialize SVG */
-	svg = (NSVGimage *)malloc(sizeof(NSVGimage));
+	svg = (NSVGimage *)arena_calloc(ctx->arena, sizeof(NSVGimage));
 	if (svg == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
-	memset(svg, 0, sizeof(NSVGimage));
 	/* initialize shape */
-	svg->shapes = createShape();
+	svg->shapes = createShape(ctx->arena, settings);
 	if (svg->shapes == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
 	shape = svg->shapes;
 	pathPtr = &(shape->paths);
 
-	/* open input file for reading */
-	fp = _tfopen(file, _T("rb"));
-	if (fp == NULL) ON_ERROR(MSGT_ERR_FILE_OPEN);
-
-	/* get file size */
-	fseeko64(fp, 0, SEEK_END);
-	inputLen = (size_t)ftello64(fp);
+	/* read input file (possibly already read in advance) */
+	switch (io_nextFile(ctx->reader, file, &inputBuf, &inputLen)) {
+	case IO_OK:
+		break;
+	case IO_ERR_NO_MEM:
+		ON_ERROR(MSGT_ERR_NO_MEM);
+		break;
+	case IO_ERR_OPEN:
+		ON_ERROR(MSGT_ERR_FILE_OPEN);
+		break;
+	default:
+		ON_ERROR(MSGT_ERR_FILE_READ);
+		break;
+	}
 	if (inputLen < 1) goto onSuccess;
-	fseek(fp, 0, SEEK_SET);
 
-	/* allocate input buffer from file data */
-	inputBuf = (char *)malloc(inputLen);
-	if (inputBuf == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
-	if (fread(inputBuf, inputLen, 1, fp) < 1) ON_ERROR(MSGT_ERR_FILE_READ);
+	/* locate the header lines of a previous run */
+	scanHeader(inputBuf, inputLen, &header);
+	if (settings->update == 0 && settings->imageOnly == 0 && (header.line[HL_POST_PROCESSED].start != NULL || header.line[HL_THUMBNAIL].start != NULL)) {
+		/* already post-processed file */
+		goto onUnchanged;
+	}
+	hash = hashBody(inputBuf, inputLen, &header, settings);
+	hash_toStr(hashStr, hash);
+	if (settings->imageOnly == 0 && header.line[HL_THUMBNAIL].start != NULL && header.value[HL_HASH].start != NULL && p_cmpToken(header.value + HL_HASH, hashStr) == 0) {
+		/* thumbnail is up-to-date */
+		goto onUnchanged;
+	}
+	if (settings->cacheDir != NULL) {
+		switch (loadCachedPngs(settings, hash, png)) {
+		case -1:
+			ON_ERROR(MSGT_ERR_NO_MEM);
+			break;
+		case 1:
+			/* cache hit; only the line count is needed from the G-Code */
+			lineNr = countLines(inputBuf, inputLen);
+			goto onThumbnail;
+		default:
+			break;
+		}
+	}
 
-	/* close input file */
-	fclose(fp);
-	fp = NULL;
+	if (settings->pipeline != 0 && header.hasBounds != 0) {
+		/* the bounds are known in advance; render while parsing */
+		setImageBounds(ctx, svg, settings, header.bounds);
+		if (startPipeline(ctx, svg, settings, &pipe) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+		isPipelined = (pipe.thread != NULL) ? 1 : 0;
+	}
 
 	/* parse tokens */
-	lineStart = inputBuf;
 	for (const char * it = inputBuf, * endIt = inputBuf + inputLen; it < endIt; it++) {
-		const char ch = *it;
+		char ch = *it;
 #ifdef DEBUG
 		_ftprintf(ferr, _T("%u:%s: '%c'"), (unsigned)lineNr, stateStr[(int)state], ch);
 		if (aToken.start != NULL) {
@@ -653,67 +2548,68 @@ int processFile(const TCHAR * file, const tCallback cb) {
 			_ftprintf(ferr, _T(", token: \"%.*S\""), (unsigned)aToken.length, aToken.start);
 #else /* not UNICODE */
 			_ftprintf(ferr, _T(", token: \"%.*s\""), (unsigned)aToken.length, aToken.start);
-#endif /* not UNICODE */
-		}
-		if (valueToken != NULL && valueToken->start != NULL) {
-#ifdef UNICODE
-			_ftprintf(ferr, _T(", value: \"%.*S\""), (unsigned)valueToken->length, valueToken->start);
-#else /* not UNICODE */
-			_ftprintf(ferr, _T(", value: \"%.*s\""), (unsigned)valueToken->length, valueToken->start);
 #endif /* not UNICODE */
 		}
 		_ftprintf(ferr, _T("\n"));
 #endif /* DEBUG */
 		switch (state) {
 		case ST_LINE_START:
-			 if (ch == ';') {
-				/* comment */
-				memset(&aToken, 0, sizeof(aToken));
-				state = ST_COMMENT;
-			} else if (ch == 'G' || ch == 'M') {
+			param = (tParam)charParam[(unsigned char)ch];
+			if (param == P_G || param == P_M) {
 				/* Gcode */
-				param = (ch == 'G') ? P_G : P_M;
+				numClass = CC_DIGIT;
 				paramX = NAN;
 				paramY = NAN;
 				paramP = NAN;
+				paramI = NAN;
+				paramJ = NAN;
+				paramR = NAN;
 				paramS = NAN;
 				aToken.start = it + 1;
 				aToken.length = 0;
 				state = ST_GCODE;
-			} else if (isspace(ch) == 0) {
-				/* code */
+			} else if ((param == P_X || param == P_Y || param == P_S) && moveCode != (unsigned int)-1) {
+				/* modal move (e.g. raster engraving lines like "X12.3S200") */
+				code = moveCode;
+				numClass = CC_DIGIT | CC_FRAC;
+				paramX = NAN;
+				paramY = NAN;
+				paramP = NAN;
+				paramI = NAN;
+				paramJ = NAN;
+				paramR = NAN;
+				paramS = NAN;
+				aToken.start = it + 1;
+				aToken.length = 0;
+				state = ST_GCODE;
+			} else if ((charClass[(unsigned char)ch] & CC_SPACE) == 0) {
+				/* comment (the handled header lines have already been located) or other code */
 				state = ST_FIND_LINE_START;
 			}
 			/* spaces */
 			break;
 		case ST_FIND_LINE_START:
-			if (ch == '\n') {
-				/* new line */
+			{
+				/* skip to the line break */
+				const char * eol = (const char *)memchr(it, '\n', (size_t)(endIt - it));
+				if (eol == NULL) {
+					it = endIt - 1;
+					break;
+				}
+				it = eol;
+				ch = '\n';
 				state = ST_LINE_START;
 			}
 			break;
 		case ST_GCODE:
-			if (isdigit(ch) != 0 || (param != P_G && param != P_M && (ch == '.' || (aToken.length == 0 && ch == '-')))) {
-				/* number */
-				aToken.length++;
-			} else if (ch == 'X') {
-				param = P_X;
-				aToken.start = it + 1;
-				aToken.length = 0;
-			} else if (ch == 'Y') {
-				param = P_Y;
-				aToken.start = it + 1;
-				aToken.length = 0;
-			} else if (ch == 'P') {
-				param = P_P;
-				aToken.start = it + 1;
-				aToken.length = 0;
-			} else if (ch == 'S') {
-				param = P_S;
-				aToken.start = it + 1;
-				aToken.length = 0;
+			if ((charClass[(unsigned char)ch] & numClass) != 0 || (ch == '-' && aToken.length == 0 && numClass != CC_DIGIT)) {
+				/* number; consume it at once as in "G1X12.3Y4.5S200" */
+				const char * numEnd = it + 1;
+				for (; numEnd < endIt && (charClass[(unsigned char)(*numEnd)] & numClass) != 0; numEnd++);
+				aToken.length += (size_t)(numEnd - it);
+				it = numEnd - 1;
 			} else {
-				/* end of token */
+				/* end of token (this may directly be followed by the next one as in "G1X12S200") */
 				switch (param) {
 				case P_G:
 					code = GCODE('G', p_uint(&aToken));
@@ -730,45 +2626,61 @@ int processFile(const TCHAR * file, const tCallback cb) {
 				case P_P:
 					paramP = p_float(&aToken);
 					break;
+				case P_I:
+					paramI = p_float(&aToken);
+					break;
+				case P_J:
+					paramJ = p_float(&aToken);
+					break;
+				case P_R:
+					paramR = p_float(&aToken);
+					break;
 				case P_S:
 					paramS = p_float(&aToken);
 					break;
 				default:
 					break;
 				}
-				param = P_UNKNOWN;
-				if (ch == '\n' || ch == ';') {
+				param = (tParam)charParam[(unsigned char)ch];
+				numClass = CC_DIGIT | CC_FRAC;
+				if (param == P_G || param == P_M) {
+					/* only the first G/M code of a line is evaluated */
+					param = P_UNKNOWN;
+				} else if (param != P_UNKNOWN) {
+					/* next parameter */
+					aToken.start = it + 1;
+					aToken.length = 0;
+				} else if ((charClass[(unsigned char)ch] & CC_EOL) != 0) {
 					/* new line or start of comment */
 					switch (code) {
 					case GCODE('G', 0): /* linear move */
 					case GCODE('G', 1): /* linear move */
+					case GCODE('G', 2): /* clockwise arc move */
+					case GCODE('G', 3): /* counter-clockwise arc move */
+						moveCode = code;
+						if ( IS_SET(paramS) ) {
+							/* inline laser power */
+							pwr = (paramS * 100.0f) / 255.0f;
+						}
 						if (pwrOn != 0 && pwr > 0.0f && prevOn == 0) {
 							/* powered move after non-powered move */
-							if ( IS_SET(x) ) {
-								if (minX > x) {
-									minX = x;
-								}
-								if (maxX < x) {
-									maxX = x;
-								}
-							}
-							if ( IS_SET(y) ) {
-								if (minY > y) {
-									minY = y;
-								}
-								if (maxY < y) {
-									maxY = y;
-								}
-							}
+							/* track bounds (unset coordinates are ignored as NaN compares false) */
+							minX = PCF_MIN(minX, x);
+							minY = PCF_MIN(minY, y);
+							maxX = PCF_MAX(x, maxX);
+							maxY = PCF_MAX(y, maxY);
 							if (IS_SET(x) && IS_SET(y)) {
 								/* powered move after non-powered move */
 								/* add first point */
 								pointVec = addPoint(pointVec, x, y);
 								if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
 							}
+							pathPwr = pwr;
 							prevOn = 1;
 						}
 						/* calculate new position */
+						prevX = x;
+						prevY = y;
 						if ( IS_SET(paramX) ) {
 							if (isAbsPos != 0) {
 								x = paramX;
@@ -783,36 +2695,120 @@ int processFile(const TCHAR * file, const tCallback cb) {
 								y += paramY;
 							}
 						}
+						/* get arc center (I/J are always relative to the start point) */
+						isArc = 0;
+						if ((code == GCODE('G', 2) || code == GCODE('G', 3)) && IS_SET(prevX) && IS_SET(prevY)) {
+							if (IS_SET(paramI) || IS_SET(paramJ)) {
+								arcX = prevX + (IS_SET(paramI) ? paramI : 0.0f);
+								arcY = prevY + (IS_SET(paramJ) ? paramJ : 0.0f);
+								isArc = 1;
+							} else if ( IS_SET(paramR) ) {
+								isArc = getArcCenter(prevX, prevY, x, y, paramR, (code == GCODE('G', 2)) ? 1 : 0, &arcX, &arcY);
+							}
+						}
 						if (pwrOn != 0 && pwr > 0.0f) {
 							/* powered move */
-							if ( IS_SET(paramX) ) {
-								if (minX > x) {
-									minX = x;
-								}
-								if (maxX < x) {
-									maxX = x;
+							/* track bounds (unset coordinates are ignored as NaN compares false) */
+							minX = PCF_MIN(minX, x);
+							minY = PCF_MIN(minY, y);
+							maxX = PCF_MAX(x, maxX);
+							maxY = PCF_MAX(y, maxY);
+							if (isArc == 0 && y == prevY && IS_SET(prevX) && (inSpan != 0 || (pointVec->size - pointVec->start) <= 1)) {
+								/* horizontal move at the start of or within a scan line run */
+								/* the run is only passed on once it is known to end as scan line run */
+								spans = addSpan(spans, prevX, x, y, pwr, (inSpan == 0) ? 1 : 0);
+								if (spans == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+								if (inSpan == 0) runStart = spans->size - 1;
+								/* drop the single start point of the path */
+								pointVec->start = pointVec->size;
+								inSpan = 1;
+							} else {
+								if (inSpan != 0) {
+									/* the run continues as regular path; move its spans into the path to
+									 * render the joints with the path instead of compositing them twice */
+									const tSpan * first = spans->data + runStart;
+									float runX = ((first->caps & ACCUM_CAP_START) != 0) ? first->x0 : first->x1;
+									pointVec = addPoint(pointVec, runX, prevY);
+									if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+									pathPwr = first->power;
+									for (size_t i = runStart; i < spans->size; i++) {
+										const tSpan * span = spans->data + i;
+										const float toX = (span->x0 == runX) ? span->x1 : span->x0;
+										if (settings->mode == RM_POWER && pathPwr != span->power) {
+											/* laser power changed within a powered path */
+											if ((pointVec->size - pointVec->start) > 1) {
+												path = pointsToPath(ctx, settings, pathPtr, pointVec, pathPwr);
+												if (path == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+												pipePath(&pipe, path);
+												pathPtr = &(path->next);
+												pointVec = addPoint(pointVec, runX, prevY);
+												if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+											}
+											pathPwr = span->power;
+										}
+										if (splitPath(ctx, settings, &pipe, &pathPtr, pointVec, pathPwr, 3) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+										pointVec = addLine(pointVec, toX, prevY);
+										if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+										runX = toX;
+									}
+									spans->size = runStart;
+									inSpan = 0;
 								}
-							}
-							if ( IS_SET(paramY) ) {
-								if (minY > y) {
-									minY = y;
+								if (settings->mode == RM_POWER && pathPwr != pwr) {
+									/* laser power changed within a powered path */
+									if ((pointVec->size - pointVec->start) > 1) {
+										/* move completed path to shape and continue with a new one */
+										path = pointsToPath(ctx, settings, pathPtr, pointVec, pathPwr);
+										if (path == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+										pipePath(&pipe, path);
+										pathPtr = &(path->next);
+										pointVec = addPoint(pointVec, prevX, prevY);
+										if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+									}
+									pathPwr = pwr;
 								}
-								if (maxY < y) {
-									maxY = y;
+								if (pointVec->size <= pointVec->start) {
+									/* unknown start position; start a new path at the destination */
+									if (IS_SET(x) && IS_SET(y)) {
+										pointVec = addPoint(pointVec, x, y);
+										if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+									}
+								} else if (isArc != 0) {
+									/* add arc to new point */
+									if (splitPath(ctx, settings, &pipe, &pathPtr, pointVec, pathPwr, ARC_MAX_POINTS) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+									const size_t first = pointVec->size;
+									pointVec = addArc(pointVec, arcX, arcY, x, y, (code == GCODE('G', 2)) ? 1 : 0);
+									if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+									/* the curve end points include the arc extrema */
+									for (size_t i = first + 2; i < pointVec->size; i += 3) {
+										minX = PCF_MIN(minX, pointVec->data[2 * i]);
+										minY = PCF_MIN(minY, pointVec->data[(2 * i) + 1]);
+										maxX = PCF_MAX(pointVec->data[2 * i], maxX);
+										maxY = PCF_MAX(pointVec->data[(2 * i) + 1], maxY);
+									}
+								} else {
+									/* add line to new point */
+									if (splitPath(ctx, settings, &pipe, &pathPtr, pointVec, pathPwr, 3) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+									pointVec = addLine(pointVec, x, y);
+									if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
 								}
 							}
-							/* add line to new point */
-							pointVec = addLine(pointVec, x, y);
-							if (pointVec == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
 							prevOn = 1;
 						} else if (prevOn != 0) {
 							/* non-powered move after powered move */
-							if (pointVec != NULL && (pointVec->size - pointVec->start) > 1) {
+							if (inSpan != 0) {
+								/* end of scan line run */
+								endSpanRun(spans, prevX);
+								pipeSpans(&pipe, spans, spans->size);
+								inSpan = 0;
+							}
+							if ((pointVec->size - pointVec->start) > 1) {
 								/* move completed path to shape */
-								path = pointsToPath(pathPtr, pointVec);
+								path = pointsToPath(ctx, settings, pathPtr, pointVec, pathPwr);
 								if (path == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+								pipePath(&pipe, path);
 								pathPtr = &(path->next);
-							} else if (pointVec != NULL) {
+							} else {
 								/* reset start */
 								pointVec->start = pointVec->size;
 							}
@@ -845,202 +2841,206 @@ int processFile(const TCHAR * file, const tCallback cb) {
 						state = ST_LINE_START;
 					} else {
 						/* comment */
-						memset(&aToken, 0, sizeof(aToken));
-						state = ST_COMMENT;
-					}
-				}
-			}
-			break;
-		case ST_COMMENT:
-			if (ch == '\n') {
-				/* end of comment line */
-				state = ST_LINE_START;
-			} else if (aToken.start == NULL) {
-				if (isspace(ch) == 0) {
-					/* start of first word in comment */
-					aToken.start = it;
-					aToken.length = 1;
-				}
-			} else if (ch == ' ' && aToken.length > 0) {
-				if (p_cmpToken(&aToken, "post-processed by sm2lbpp") == 0) {
-					/* already post-processed file */
-					goto onSuccess;
-				}
-			} else if (ch == ':') {
-				/* end of commented parameter key */
-				if (aToken.length == 0) {
-					aToken.length = (size_t)(it - aToken.start);
-				}
-				if (p_cmpToken(&aToken, "thumbnail") == 0) {
-					/* thumbnail already included */
-					goto onSuccess;
-				} else if (p_cmpToken(&aToken, "file_total_lines") == 0) {
-					totalLinesLine.start = lineStart;
-					totalLinesLine.length = 0;
-					valueToken = &totalLines;
-				} else {
-					state = ST_FIND_LINE_START;
-				}
-				if (valueToken != NULL) {
-					memset(&aToken, 0, sizeof(aToken));
-					if (valueToken->start == NULL) {
-						state = ST_PARAMETER_VALUE;
-					} else {
-						/* ignore duplicate keys */
-						valueToken = NULL;
 						state = ST_FIND_LINE_START;
 					}
 				}
-			} else if (isspace(ch) == 0) {
-				/* ignore trailing spaces */
-				aToken.length = (size_t)(it - aToken.start + 1);
-			}
-			break;
-		case ST_PARAMETER_VALUE:
-			if (ch == '\n') {
-				/* end of comment line */
-				valueToken = NULL;
-				state = ST_LINE_START;
-				/* remember full line extend to replace it later */
-				if (totalLinesLine.start != NULL && totalLinesLine.length == 0) {
-					totalLinesLine.length = (size_t)(it - totalLinesLine.start + 1);
-				}
-			} else if (valueToken->start == NULL) {
-				if (isspace(ch) == 0) {
-					/* start of comment parameter value */
-					valueToken->start = it;
-					valueToken->length = 1;
-				}
-			} else if (isspace(ch) == 0) {
-				/* ignore trailing spaces */
-				valueToken->length = (size_t)(it - valueToken->start + 1);
 			}
 			break;
 		}
 		if (ch == '\n') {
 			lineNr++;
-			lineStart = it + 1;
-		} else if (ch == '\r') {
-			lineStart = it + 1;
 		}
 	}
 
-	if (pointVec != NULL) {
-		/* add final path */
-		if ((pointVec->size - pointVec->start) > 1) {
-			/* move completed path to shape */
-			path = pointsToPath(pathPtr, pointVec);
-			if (path == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
-			pathPtr = &(path->next);
-		}
-
-		/* update base address to the most recent value of pointVec->data (there is only one shape) */
-		setPointsDataOffset(shape->paths, pointVec->data);
+	if (inSpan != 0) {
+		/* end of final scan line run */
+		endSpanRun(spans, x);
+		pipeSpans(&pipe, spans, spans->size);
 	}
 
-	/* check missing tokens */
-	if (totalLines.start == NULL || totalLines.length == 0) ON_WARN(MSGT_WARN_NO_TOTAL_LINES);
-	if (totalLinesLine.start == NULL || totalLinesLine.length == 0) ON_WARN(MSGT_WARN_NO_TOTAL_LINES_LINE);
+	if ((pointVec->size - pointVec->start) > 1) {
+		/* add final path */
+		path = pointsToPath(ctx, settings, pathPtr, pointVec, pathPwr);
+		if (path == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+		pipePath(&pipe, path);
+		pathPtr = &(path->next);
+	}
 
-	/* allocate image */
-	img = (png_bytep)malloc(IMAGE_WIDTH * IMAGE_HEIGHT * 4);
-	if (img == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+	if (isPipelined != 0) {
+		/* wait for the render thread to accumulate the remaining items */
+		if (finishPipeline(&pipe) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+	}
 
 	/* there is only one shape with all paths */
-	if (shape->paths != NULL) {
-		/* realign shape to (5, 5) */
-		for (path = shape->paths; path != NULL; path = path->next) {
-			for (int i = 0; i < path->npts; i++) {
-				path->pts[(2 * i) + 0] -= (minX - BORDER_WIDTH);
-				path->pts[(2 * i) + 1] -= (minY - BORDER_HEIGHT);
-			}
+	if (shape->paths != NULL || (spans != NULL && spans->size > 0)) {
+		if (isPipelined == 0) {
+			const float bounds[4] = {minX, minY, maxX, maxY};
+			setImageBounds(ctx, svg, settings, bounds);
+		}
+		if (shape->paths != NULL && ctx->rast == NULL) {
+			ctx->rast = nsvgCreateRasterizer();
+			if (ctx->rast == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+			nsvgSetPathDecoder(ctx->rast, getPathPoints, ctx);
+			nsvgSetCoverageKernels(ctx->rast, simd_getAddWeight(), simd_getBlendMask());
 		}
-		/* update shape and path bounds */
-		setPathBounds(shape->paths);
-		shape->bounds[0] = shape->paths->bounds[0];
-		shape->bounds[1] = shape->paths->bounds[1];
-		shape->bounds[2] = shape->paths->bounds[2];
-		shape->bounds[3] = shape->paths->bounds[3];
-		for (path = shape->paths->next; path != NULL; path = path->next) {
-			setPathBounds(path);
-			shape->bounds[0] = PCF_MIN(shape->bounds[0], path->bounds[0]);
-			shape->bounds[1] = PCF_MIN(shape->bounds[1], path->bounds[1]);
-			shape->bounds[2] = PCF_MAX(shape->bounds[2], path->bounds[2]);
-			shape->bounds[3] = PCF_MAX(shape->bounds[3], path->bounds[3]);
+	}
+
+	/* render to images from the largest to the smallest size */
+	planRender(settings, renderOrder, renderSrc, renderLevel);
+	for (size_t n = 0; n < settings->sizeCount; n++) {
+		const size_t i = renderOrder[n];
+		if (renderLevel[i] == 0 && isBanded(settings->size + i) != 0) {
+			/* rendered while encoding */
+			continue;
 		}
-		/* update resolution with border of (5, 5) */
-		shape = svg->shapes;
-		svg->width = shape->bounds[2] + (2.0f * BORDER_WIDTH);
-		svg->height = shape->bounds[3] + (2.0f * BORDER_HEIGHT);
-		/* render to image */
-		rast = nsvgCreateRasterizer();
-		if (rast == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
-		const float scaleX = (float)IMAGE_WIDTH / svg->width;
-		const float scaleY = (float)IMAGE_HEIGHT / svg->height;
-		const float scale = PCF_MIN(scaleX, scaleY);
-		/* calculate offset for centered output */
-		const float tx = ((float)IMAGE_WIDTH - (svg->width * scale)) / 2.0f;
-		const float ty = ((float)IMAGE_HEIGHT - (svg->height * scale)) / 2.0f;
-		nsvgRasterize(rast, svg, tx, ty, scale, (unsigned char *)img, IMAGE_WIDTH, IMAGE_HEIGHT, IMAGE_WIDTH * 4);
-		/* create opaque background color */
-		for (size_t i = 0; i < (IMAGE_WIDTH * IMAGE_HEIGHT); i++) {
-			blendByAlpha(img + (4 * i), BACKGROUND_COLOR);
+		if (renderLevel[i] > 0) {
+			img[i] = downsampleImage(img[renderSrc[i]], settings->size + renderSrc[i], renderLevel[i]);
+		} else {
+			img[i] = renderImage(ctx, svg, spans, settings, settings->size + i, pipe.acc[i]);
+			pipe.acc[i] = NULL; /* deleted by renderImage() */
 		}
+		if (img[i] == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
 	}
 
-	/* flip vertically and convert bitmap to PNG */
-	imgRows = (png_bytepp)malloc(IMAGE_HEIGHT * sizeof(png_bytep));
-	if (imgRows == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
-	for (size_t i = 0; i < IMAGE_HEIGHT; i++) {
-		imgRows[IMAGE_HEIGHT - i - 1] = img + (i * IMAGE_WIDTH * 4);
+	/* convert bitmaps to PNG */
+	for (size_t i = 0; i < settings->sizeCount; i++) {
+		const int pngRes = (img[i] != NULL) ? imgToPng(ctx, img[i], settings->size + i, settings, png + i) : renderToPng(ctx, svg, spans, settings, settings->size + i, png + i);
+		switch (pngRes) {
+		case -1:
+			ON_ERROR(MSGT_ERR_PNG);
+			break;
+		case 0:
+			ON_ERROR(MSGT_ERR_NO_MEM);
+			break;
+		default:
+			break;
+		}
 	}
-	switch (imgToPng(imgRows, &png)) {
-	case -1:
-		ON_ERROR(MSGT_ERR_PNG);
-		break;
-	case 0:
-		ON_ERROR(MSGT_ERR_NO_MEM);
-		break;
-	default:
-		break;
+
+	if (settings->cacheDir != NULL) {
+		/* a failure to update the cache does not affect the output */
+		storeCachedPngs(settings, hash, png, cb);
 	}
 
-	/* re-create file */
-	fp = _tfopen(file, _T("wb"));
-	if (fp == NULL) ON_ERROR(MSGT_ERR_FILE_CREATE);
-
-	/* output modified Snapmaker 2.0 specific header */
-	clearerr(fp);
-	fprintf(fp, ";post-processed by sm2lbpp " PROGRAM_VERSION_STR " (https://github.com/daniel-starke/sm2lbpp)\n");
-	/* output until line containing 'file_total_lines' */
-	fwrite(inputBuf, (size_t)(totalLinesLine.start - inputBuf), 1, fp);
-	/* output corrected line count */
-	fprintf(fp, ";file_total_lines: %lu\n", (unsigned long)(lineNr + 2));
-	/* output base64 encoded PNG of the preview image */
-	fprintf(fp, ";thumbnail: data:image/png;base64,");
-	writeBase64(fp, (const unsigned char *)(png.data), png.size);
-	fprintf(fp, "\n");
-	if (ferror(fp) != 0) ON_ERROR(MSGT_ERR_FILE_WRITE);
+onThumbnail:
+	if (settings->imageOnly != 0) goto onImages;
+
+	/* check missing tokens */
+	if (header.line[HL_TOTAL_LINES].start == NULL || header.value[HL_TOTAL_LINES].length == 0) {
+		ON_WARN(MSGT_WARN_NO_TOTAL_LINES);
+	} else if (header.line[HL_TOTAL_LINES].start[header.line[HL_TOTAL_LINES].length - 1] != '\n') {
+		ON_WARN(MSGT_WARN_NO_TOTAL_LINES_LINE);
+	}
 
-	/* output remaining file */
+	/* the new post-processing note, thumbnail and hash lines replace those of a previous run */
+	totalLines = lineNr + 3;
+	if (header.line[HL_TOTAL_LINES].start == NULL) totalLines++;
+	if (header.line[HL_POST_PROCESSED].start != NULL) totalLines--;
+	if (header.line[HL_THUMBNAIL].start != NULL) totalLines--;
+	if (header.line[HL_HASH].start != NULL) totalLines--;
+
+	/* create modified Snapmaker 2.0 specific header */
+	job.buffers[0] = malloc(sizeof(POST_PROCESSED_LINE) + HEADER_LINES_SIZE(png[0].size));
+	job.segments = (tIoSegment *)malloc(((2 * HL_COUNT) + 3) * sizeof(tIoSegment));
+	if (job.buffers[0] == NULL || job.segments == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
 	{
-		totalLinesLine.start += totalLinesLine.length;
-		if (fwrite(totalLinesLine.start, (size_t)(inputBuf + inputLen - totalLinesLine.start), 1, fp) < 1) {
+		char * hdrBuf = (char *)(job.buffers[0]);
+		const size_t hdrLen = formatHeaderLines(hdrBuf + sizeof(POST_PROCESSED_LINE) - 1, totalLines, png, hashStr);
+		memcpy(hdrBuf, POST_PROCESSED_LINE, sizeof(POST_PROCESSED_LINE) - 1);
+		job.segments[job.count].data = hdrBuf;
+		job.segments[job.count].size = sizeof(POST_PROCESSED_LINE) - 1;
+		job.count++;
+		if (header.line[HL_TOTAL_LINES].start == NULL) {
+			/* no line containing 'file_total_lines' to replace */
+			job.segments[job.count - 1].size += hdrLen;
+		}
+		/* output input file with the handled header lines replaced */
+		for (const char * it = inputBuf, * endIt = inputBuf + inputLen; it < endIt; ) {
+			const int i = nextHeaderLine(&header, it);
+			const char * next = (i < HL_COUNT) ? header.line[i].start : endIt;
+			job.segments[job.count].data = it;
+			job.segments[job.count].size = (size_t)(next - it);
+			job.count++;
+			if (i >= HL_COUNT) break;
+			if (i == HL_TOTAL_LINES) {
+				job.segments[job.count].data = hdrBuf + sizeof(POST_PROCESSED_LINE) - 1;
+				job.segments[job.count].size = hdrLen;
+				job.count++;
+			}
+			it = next + header.line[i].length;
+		}
+	}
+
+	/* re-create file */
+	isWritten = 1;
+	if (ctx->writer != NULL) {
+		/* written in the background; errors are reported by the writer */
+		job.file = (TCHAR *)malloc((_tcslen(file) + 1) * sizeof(TCHAR));
+		if (job.file == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+		memcpy(job.file, file, (_tcslen(file) + 1) * sizeof(TCHAR));
+		job.buffers[1] = inputBuf;
+		inputBuf = NULL;
+		io_queueWrite(ctx->writer, &job);
+	} else {
+		switch (io_writeFile(file, job.segments, job.count)) {
+		case IO_OK:
+			break;
+		case IO_ERR_CREATE:
+			ON_ERROR(MSGT_ERR_FILE_CREATE);
+			break;
+		default:
 			ON_ERROR(MSGT_ERR_FILE_WRITE);
+			break;
+		}
+	}
+
+onImages:
+	/* output additional thumbnails (all thumbnails in image only mode) */
+	for (size_t i = (settings->imageOnly != 0) ? 0 : 1; i < settings->sizeCount; i++) {
+		if (i == 0 && io_isStdio(file) != 0) {
+			/* first thumbnail to standard output */
+			if (writePngFile(file, png, cb) != 1) goto onError;
+			continue;
 		}
+		pngFile = getThumbnailPath(file, settings->size + i);
+		if (pngFile == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+		if (writePngFile(pngFile, png + i, cb) != 1) goto onError;
+		free(pngFile);
+		pngFile = NULL;
+	}
+	goto onSuccess;
+onUnchanged:
+	if (io_isStdio(file) != 0) {
+		/* pass the input through unchanged if used as filter */
+		tIoSegment input;
+		input.data = inputBuf;
+		input.size = inputLen;
+		isWritten = 1;
+		if (io_writeFile(file, &input, 1) != IO_OK) ON_ERROR(MSGT_ERR_FILE_WRITE);
 	}
 onSuccess:
 	res = 1;
 onError:
-	if (png.data != NULL) free(png.data);
-	if (imgRows != NULL) free(imgRows);
-	if (img != NULL) free(img);
-	if (rast != NULL) nsvgDeleteRasterizer(rast);
-	if (pointVec != NULL) deletePointVec(pointVec);
-	if (svg != NULL) deleteSvg(svg);
-	if (fp != NULL) fclose(fp);
+	finishPipeline(&pipe);
+	if (res != 1 && isWritten == 0 && inputBuf != NULL && settings->imageOnly == 0 && io_isStdio(file) != 0) {
+		/* keep the filter chain intact by passing the input through unchanged; the error is still returned */
+		tIoSegment input;
+		input.data = inputBuf;
+		input.size = inputLen;
+		io_writeFile(file, &input, 1);
+	}
+	for (size_t i = 0; i < MAX_THUMBNAILS; i++) {
+		if (png[i].data != NULL) free(png[i].data);
+		if (img[i] != NULL) free(img[i]);
+		acc_delete(pipe.acc[i]);
+	}
+	if (pngFile != NULL) free(pngFile);
+	/* the span vector is kept for the next file (it is NULL if it was freed on error) */
+	ctx->spans = spans;
+	io_freeJob(&job);
 	if (inputBuf != NULL) free(inputBuf);
-	if (res != 1) {
+	if (res != 1 && io_isStdio(file) == 0) {
+		/* the standard input is used for the G-Code in filter mode */
 		_ftprintf(ferr, _T("%s"), fmsg[MSGT_INFO_PRESS_ENTER]);
 		_gettchar();
 	}
@@ -1068,3 +3068,25 @@ int errorCallback(const tMessage msg, const TCHAR * file, const size_t line) {
 	}
 	return 1;
 }
+
+
+/**
+ * Error output callback for background writes. This is called from the main
+ * thread once the failed write job is collected and reports the error like
+ * processFile() does for synchronous writes.
+ *
+ * @param[in] status - write error
+ * @param[in] file - output file path
+ */
+void ioErrorCallback(const tIoStatus status, const TCHAR * file) {
+	switch (status) {
+	case IO_ERR_NO_MEM: errorCallback(MSGT_ERR_NO_MEM, file, 0); break;
+	case IO_ERR_CREATE: errorCallback(MSGT_ERR_FILE_CREATE, file, 0); break;
+	default:            errorCallback(MSGT_ERR_FILE_WRITE, file, 0); break;
+	}
+	if (io_isStdio(file) == 0) {
+		/* the standard input is used for the G-Code in filter mode */
+		_ftprintf(ferr, _T("%s"), fmsg[MSGT_INFO_PRESS_ENTER]);
+		_gettchar();
+	}
+}
@@ -2,7 +2,7 @@
  * @file sm2lbpp.h
  * @author Daniel Starke
  * @date 2023-05-10
- * @version 2023-05-18
+ * @version 2026-10-18
  *
  * DISCLAIMER
  * This file has no copyright assigned and is placed in the Public Domain.
@@ -32,8 +32,16 @@
 #include "../nanosvg/nanosvg.h"
 #define NANOSVGRAST_IMPLEMENTATION
 #include "../nanosvg/nanosvgrast.h"
+#include "accum.h"
+#include "arena.h"
+#include "compact.h"
+#include "hash.h"
+#include "io.h"
 #include "parser.h"
+#include "pngenc.h"
+#include "simd.h"
 #include "tchar.h"
+#include "thread.h"
 #include "version.h"
 
 /**
@@ -50,36 +58,60 @@
 /** Input line buffer size(in bytes). */
 #define LINE_BUFFER_SIZE 0x80000UL
 
-/** Initial point vector size (in bytes). */
+/** Initial span vector size (in bytes). */
 #define VEC_INIT_SIZE 0x10000UL
 
-/** Maximum point vector grow size (in bytes). */
+/** Maximum span vector grow size (in bytes). */
 #define VEC_MAX_GROW_SIZE 0x8000000UL
 
-/** Output image pixel width. */
+/** Point vector chunk size (in bytes). */
+#define POINT_CHUNK_SIZE 0x40000UL
+
+/** Maximum number of points added by a single arc move (up to 5 cubic bezier curves). */
+#define ARC_MAX_POINTS 15
+
+/** Default output image pixel width. */
 #define IMAGE_WIDTH 300
 
-/** Output image pixel height. */
+/** Default output image pixel height. */
 #define IMAGE_HEIGHT 150
 
-/** Laser point diameter in workspace millimeters. This is used as stroke width. */
+/** Maximum output image pixel width and height. */
+#define IMAGE_MAX_SIZE 16384
+
+/** Maximum number of files read ahead or written behind. */
+#define ASYNC_MAX_DEPTH 64
+
+/** Maximum number of pixels rendered at once. Larger images are rendered and encoded band by band. */
+#define RENDER_BAND_PIXELS 0x400000UL
+
+/** Maximum number of thumbnail sizes per run. */
+#define MAX_THUMBNAILS 8
+
+/** Default laser point diameter in workspace millimeters. This is used as stroke width. */
 #define STROKE_WIDTH 0.3f
 
-/** Background color in ABGR. The alpha channel is discarded. */
+/** Default background color in ABGR. The alpha channel is discarded. */
 #define BACKGROUND_COLOR COLOR(255, 255, 255, 255)
 
-/** Stroke color in ABGR. */
+/** Default stroke color in ABGR. */
 #define STROKE_COLOR COLOR(0, 0, 0, 255)
 
-/** Fill color in ABGR. */
-#define FILL_COLOR COLOR(255, 255, 255, 0) /* white, fully transparent */
-
-/** Horizontal border clearance in workspace millimeters. */
+/** Default horizontal border clearance in workspace millimeters. */
 #define BORDER_WIDTH 1.0f
 
-/** Vertical border clearance in workspace millimeters. */
+/** Default vertical border clearance in workspace millimeters. */
 #define BORDER_HEIGHT 1.0f
 
+/** First line written to each processed G-Code file. */
+#define POST_PROCESSED_LINE ";post-processed by sm2lbpp " PROGRAM_VERSION_STR " (https://github.com/daniel-starke/sm2lbpp)\n"
+
+/** Number of bytes needed to Base64 encode the given number of bytes. */
+#define BASE64_SIZE(x) (4 * (((x) + 2) / 3))
+
+/** Upper limit of bytes written by formatHeaderLines() for a PNG of the given size. */
+#define HEADER_LINES_SIZE(x) (256 + BASE64_SIZE(x))
+
 
 /** Enumeration of possible error values. */
 typedef enum {
@@ -94,6 +126,11 @@ typedef enum {
 	MSGT_WARN_NO_TOTAL_LINES,
 	MSGT_WARN_NO_TOTAL_LINES_LINE,
 	MSGT_INFO_PRESS_ENTER,
+	MSGT_ERR_OPT_NO_ARG,
+	MSGT_ERR_OPT_BAD_ARG,
+	MSGT_ERR_OPT_UNKNOWN,
+	MSGT_ERR_OPT_TOO_MANY_SIZES,
+	MSGT_ERR_OPT_BAD_CPU,
 	MSG_COUNT
 } tMessage;
 
@@ -102,15 +139,192 @@ typedef enum {
 typedef int (* tCallback)(const tMessage msg, const TCHAR * file, const size_t line);
 
 
-/** Defines the structure for a point vector. */
+/**
+ * Defines the structure for a chunked point vector. The points are stored in
+ * fixed size chunks from an arena. The points of a path are contiguous and
+ * never move. Paths which exceed a chunk are split into multiple paths.
+ */
 typedef struct {
-	size_t start;    /**< The start size of the vector in number of points. */
-	size_t size;     /**< The current size of the vector in number of points. */
-	size_t capacity; /**< The maximum capacity of the vector in number of points. */
-	float * data;    /**< The pointed memory of the point vector. */
+	tArena * arena;  /**< The arena which provides the point chunks. */
+	size_t start;    /**< The start of the current path within the current chunk in number of points. */
+	size_t size;     /**< The used size of the current chunk in number of points. */
+	size_t capacity; /**< The capacity of the current chunk in number of points. */
+	float * data;    /**< The current point chunk. */
+	int isContinued; /**< Set if the current path continues the previous one (see splitPath()). */
 } tPointVec;
 
 
+/** Defines a horizontal powered move as emitted for raster engravings. */
+typedef struct {
+	float x0;    /**< Start x coordinate (always less or equal to x1). */
+	float x1;    /**< End x coordinate. */
+	float y;     /**< y coordinate. */
+	float power; /**< Laser power in percent (0..100). */
+	int caps;    /**< Line caps at the start/end of a scan line run (see tAccumCap). */
+} tSpan;
+
+
+/** Defines the structure for a span vector. */
+typedef struct {
+	size_t size;     /**< The current size of the vector in number of spans. */
+	size_t capacity; /**< The maximum capacity of the vector in number of spans. */
+	tSpan * data;    /**< The pointed memory of the span vector. */
+} tSpanVec;
+
+
+/** Possible thumbnail render modes. */
+typedef enum {
+	RM_STROKE, /**< all powered moves are drawn with the stroke color */
+	RM_POWER   /**< powered moves are weighted by their laser power */
+} tRenderMode;
+
+
+/** Possible PNG encoders. */
+typedef enum {
+	PE_LIBPNG, /**< libpng as reference encoder */
+	PE_ZLIB,   /**< built-in encoder with the same filters and compression level as libpng */
+	PE_FAST    /**< built-in encoder with a fixed filter and run-length compression */
+} tPngEncoder;
+
+
+/** Character class flags of the G-Code tokenizer. */
+typedef enum {
+	CC_DIGIT = 0x01, /**< '0' to '9' */
+	CC_FRAC  = 0x02, /**< decimal point */
+	CC_SIGN  = 0x04, /**< minus sign */
+	CC_SPACE = 0x08, /**< white-space including line breaks */
+	CC_EOL   = 0x10  /**< end of the G-Code part of the line (line break or comment) */
+} tCharClass;
+
+
+/** G-Code letters evaluated by the tokenizer. */
+typedef enum {
+	P_G,
+	P_M,
+	P_X,
+	P_Y,
+	P_P,
+	P_I,
+	P_J,
+	P_R,
+	P_S,
+	P_UNKNOWN
+} tParam;
+
+
+/** Defines a nanosvg path with its associated laser power. */
+typedef struct {
+	NSVGpath path;              /**< nanosvg path (needs to be the first member) */
+	float power;                /**< laser power in percent (0..100) */
+	int caps;                   /**< line caps at the path ends (see tAccumCap) */
+	const unsigned char * code; /**< compact encoded points (path.pts is NULL) or NULL */
+	float origin[2];            /**< first point of the compact encoded points */
+} tPath;
+
+
+/** Defines a single thumbnail output size. */
+typedef struct {
+	int width;  /**< Output image pixel width. */
+	int height; /**< Output image pixel height. */
+} tSize;
+
+
+/** Lines of the Snapmaker 2.0 specific G-Code header which are handled by sm2lbpp. */
+typedef enum {
+	HL_POST_PROCESSED, /**< ";post-processed by sm2lbpp ..." */
+	HL_TOTAL_LINES,    /**< ";file_total_lines: ..." */
+	HL_THUMBNAIL,      /**< ";thumbnail: ..." */
+	HL_HASH,           /**< ";sm2lbpp_hash: ..." */
+	HL_COUNT
+} tHeaderLine;
+
+
+/** Defines the location of the handled header lines within the input file. */
+typedef struct {
+	tPToken line[HL_COUNT];  /**< Full line including the line break (start is NULL if missing). */
+	tPToken value[HL_COUNT]; /**< Trimmed value after the colon. */
+	float bounds[4];         /**< Work area bounds from the header as min x, min y, max x, max y. */
+	int hasBounds;           /**< Set to 1 if all bounds were found and are valid. */
+} tHeader;
+
+
+/** Defines the user settings which control the thumbnail generation. */
+typedef struct {
+	size_t sizeCount;             /**< Number of thumbnail sizes. */
+	tSize size[MAX_THUMBNAILS];   /**< Thumbnail sizes. The first one is embedded into the G-Code. */
+	float strokeWidth;            /**< Stroke width in workspace millimeters. */
+	float borderWidth;            /**< Horizontal border clearance in workspace millimeters. */
+	float borderHeight;           /**< Vertical border clearance in workspace millimeters. */
+	unsigned int backgroundColor; /**< Background color in ABGR. */
+	unsigned int strokeColor;     /**< Stroke color in ABGR. */
+	tRenderMode mode;             /**< Render mode. */
+	int compact;                  /**< Set to 1 to use the compact point encoding. */
+	int update;                   /**< Set to 1 to replace outdated thumbnails of already post-processed files. */
+	int imageOnly;                /**< Set to 1 to write all thumbnails as PNG files without modifying the G-Code. */
+	const TCHAR * cacheDir;       /**< Thumbnail cache directory or NULL. */
+	int pipeline;                 /**< Set to 1 to render in a second thread while parsing if possible. */
+	size_t async;                 /**< Number of files to read ahead and write behind (0 for synchronous I/O). */
+	tPngEncoder encoder;          /**< PNG encoder. */
+	size_t jobs;                  /**< Number of threads used by the built-in PNG encoders. */
+} tSettings;
+
+
+/**
+ * Defines the processing context. It owns all objects which are reused
+ * between multiple input files to avoid repeated allocations.
+ */
+typedef struct {
+	tArena * arena;        /**< Arena for the SVG image, shape and path objects of the current file. */
+	tSpanVec * spans;      /**< Span vector (capacity is kept between files). */
+	NSVGrasterizer * rast; /**< Rasterizer (created on first use). */
+	tPngEnc * pngEnc;      /**< Built-in PNG encoder (created on first use). */
+	float offset[2];       /**< Realignment offset of the current file subtracted from all coordinates while rendering. */
+	void * scratch;        /**< Scratch buffer for path encoding and decoding. */
+	size_t scratchSize;    /**< Size of the scratch buffer in bytes. */
+	tIoReader * reader;    /**< Input file read-ahead or NULL (not owned). */
+	tIoWriter * writer;    /**< Output file write-behind or NULL (not owned). */
+} tContext;
+
+
+/** Defines a single item passed from the parser to the render thread. */
+typedef struct {
+	const tPath * path; /**< Completed path or NULL for a span. */
+	tSpan span;         /**< Completed span if path is NULL. */
+} tPipeItem;
+
+
+/**
+ * Defines the state of the render thread which accumulates the parsed paths
+ * and spans while the parser is still running.
+ */
+typedef struct {
+	const tSettings * settings;    /**< User settings. */
+	tRing * ring;                  /**< Queue of completed paths and spans. */
+	tThread * thread;              /**< Render thread or NULL if not running. */
+	tAccum * acc[MAX_THUMBNAILS];  /**< Accumulation buffer per size (NULL if downsampled from a larger one). */
+	size_t spanCount;              /**< Number of spans already passed to the render thread. */
+	float * points;                /**< Buffer for decoded compact paths (render thread only). */
+	size_t pointsSize;             /**< Size of the decoded path buffer in bytes. */
+	volatile int failed;           /**< Set to 1 by the render thread on allocation error. */
+} tPipeline;
+
+
+/**
+ * Defines the data shared by all bands of an image which is rendered band by
+ * band (see prepareBands()). Band 0 ends at the bottom image row.
+ */
+typedef struct {
+	int rows;                /**< Number of rows per band. */
+	int count;               /**< Number of bands. */
+	int hasEdges;            /**< Set if the paths were prepared with nsvgPrepareBands(). */
+	size_t * spanStart;      /**< Offset into spanIndex per band (count + 1 entries). */
+	size_t * spanIndex;      /**< Indices of the spans crossing each band in band order. */
+	const NSVGpath ** paths; /**< All paths in order (power mode only). */
+	size_t * pathStart;      /**< Offset into pathIndex per band (count + 1 entries, power mode only). */
+	size_t * pathIndex;      /**< Indices into paths of the paths crossing each band in band order. */
+} tBands;
+
+
 /** Defines the structure which holds the data of a PNG image. */
 typedef struct {
 	size_t size;    /**< The current size of the pointed data. */
@@ -126,8 +340,20 @@ extern const TCHAR * fmsg[MSG_COUNT];
 
 /* helper functions */
 void printHelp(void);
-int processFile(const TCHAR * file, const tCallback cb);
+int isOption(const TCHAR * arg, const TCHAR * shortOpt, const TCHAR * longOpt);
+int parseSize(const TCHAR * arg, tSize * size);
+int parseCount(const TCHAR * arg, size_t * value, const size_t maxValue);
+int parseFloatPair(const TCHAR * arg, float * a, float * b);
+int parseColor(const TCHAR * arg, unsigned int * color);
+unsigned int blendColor(const unsigned int bg, const unsigned int fg);
+int parseMode(const TCHAR * arg, tRenderMode * mode);
+int parseEncoder(const TCHAR * arg, tPngEncoder * encoder);
+int parseCpu(const TCHAR * arg, tSimdIsa * isa);
+tContext * createContext(void);
+void deleteContext(tContext * ctx);
+int processFile(tContext * ctx, const TCHAR * file, const tSettings * settings, const tCallback cb);
 int errorCallback(const tMessage msg, const TCHAR * file, const size_t line);
+void ioErrorCallback(const tIoStatus status, const TCHAR * file);
 
 
 #endif /* __SM2LBPP_H__ */
@@ -2,7 +2,7 @@
  * @file tchar.h
  * @author Daniel Starke
  * @date 2014-05-04
- * @version 2023-05-04
+ * @version 2026-10-18
  * 
  * DISCLAIMER
  * This file has no copyright assigned and is placed in the Public Domain.
@@ -46,6 +46,7 @@ typedef wchar_t TCHAR;
 #define _totupper towupper
 #define _istprint iswprint
 #define _istdigit iswdigit
+#define _istxdigit iswxdigit
 #define _tcslen wcslen
 #define _tcscmp wcscmp
 #define _tcsncmp wcsncmp
@@ -53,6 +54,7 @@ typedef wchar_t TCHAR;
 #define _tcspbrk wcspbrk
 #define _tcschr wcschr
 #define _tcstol wcstol
+#define _tcstod wcstod
 #define _ttoi _wtoi
 #define _fgetts fgetws
 #define _fputts fputws
@@ -64,6 +66,7 @@ typedef wchar_t TCHAR;
 #define _tfopen _wfopen
 #define _tstat wstat
 #define _trename _wrename
+#define _tremove _wremove
 #define _tcserror _wcserror
 
 #else /* not UNICODE */
@@ -75,6 +78,7 @@ typedef char TCHAR;
 #define _totupper toupper
 #define _istprint isprint
 #define _istdigit isdigit
+#define _istxdigit isxdigit
 #define _tcslen strlen
 #define _tcscmp strcmp
 #define _tcsncmp strncmp
@@ -82,6 +86,7 @@ typedef char TCHAR;
 #define _tcspbrk strpbrk
 #define _tcschr strchr
 #define _tcstol strtol
+#define _tcstod strtod
 #define _ttoi atoi
 #define _fgetts fgets
 #define _fputts fputs
@@ -93,11 +98,15 @@ typedef char TCHAR;
 #define _tfopen fopen
 #define _tstat stat
 #define _trename rename
+#define _tremove remove
 #define _tcserror strerror
 
 #endif /* not UNICODE */
 
 
+const TCHAR * _tcsrpbrk(const TCHAR * str1, const TCHAR * str2);
+
+
 #ifdef _MSC_VER
 # define wstat _wstat
 # define stat _stat
@@ -0,0 +1,461 @@
+/**
+ * @file thread.c
+ * @author Daniel Starke
+ * @see thread.h
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "thread.h"
+#include "target.h"
+
+#ifdef PCF_IS_WIN
+# include <limits.h>
+# include <windows.h>
+# include <process.h>
+#else /* not PCF_IS_WIN */
+# include <pthread.h>
+# include <sched.h>
+# include <unistd.h>
+#endif /* not PCF_IS_WIN */
+
+
+/** Number of busy polls before a blocked ring buffer call yields. */
+#define RING_SPIN_COUNT 64
+
+/** Number of yields after the busy polls before a blocked ring buffer call waits on its semaphore. */
+#define RING_YIELD_COUNT 8
+
+/** Number of pushed or popped items after which the other side of a ring buffer is woken up (power of two). */
+#define RING_WAKE_COUNT 64
+
+
+#if defined(__GNUC__) || defined(__clang__)
+# define ATOMIC_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+# define ATOMIC_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+# define ATOMIC_EXCHANGE(x, v) __atomic_exchange_n(&(x), (v), __ATOMIC_SEQ_CST)
+# define ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(_MSC_VER)
+/* volatile accesses have acquire/release semantics with /volatile:ms (default for x86/x64) */
+# define ATOMIC_LOAD(x) (x)
+# define ATOMIC_STORE(x, v) ((x) = (v))
+# define ATOMIC_EXCHANGE(x, v) InterlockedExchange(&(x), (v))
+# define ATOMIC_FENCE() MemoryBarrier()
+#else
+# error Unsupported compiler. Atomic load/store operations are missing.
+#endif
+
+
+/** Defines the thread handle. */
+struct tThread {
+#ifdef PCF_IS_WIN
+	HANDLE handle;  /**< Native thread handle. */
+#else /* not PCF_IS_WIN */
+	pthread_t handle; /**< Native thread handle. */
+#endif /* not PCF_IS_WIN */
+	tThreadFn fn;   /**< Thread function. */
+	void * arg;     /**< Thread function argument. */
+};
+
+
+/** Defines the counting semaphore handle. */
+struct tSemaphore {
+#ifdef PCF_IS_WIN
+	HANDLE handle;         /**< Native semaphore handle. */
+#else /* not PCF_IS_WIN */
+	pthread_mutex_t mutex; /**< Protects count. */
+	pthread_cond_t cond;   /**< Signaled if count was increased. */
+	unsigned int count;    /**< Current semaphore value. */
+#endif /* not PCF_IS_WIN */
+};
+
+
+#ifdef PCF_IS_WIN
+/**
+ * Native thread entry point.
+ *
+ * @param[in] arg - thread handle
+ * @return 0
+ */
+static unsigned __stdcall threadEntry(void * arg) {
+	tThread * thread = (tThread *)arg;
+	thread->fn(thread->arg);
+	return 0;
+}
+#else /* not PCF_IS_WIN */
+/**
+ * Native thread entry point.
+ *
+ * @param[in] arg - thread handle
+ * @return NULL
+ */
+static void * threadEntry(void * arg) {
+	tThread * thread = (tThread *)arg;
+	thread->fn(thread->arg);
+	return NULL;
+}
+#endif /* not PCF_IS_WIN */
+
+
+/**
+ * Creates and starts a new thread.
+ *
+ * @param[in] fn - thread function
+ * @param[in] arg - thread function argument
+ * @return thread handle or NULL on error
+ */
+tThread * thread_create(tThreadFn fn, void * arg) {
+	if (fn == NULL) return NULL;
+	tThread * thread = (tThread *)malloc(sizeof(tThread));
+	if (thread == NULL) return NULL;
+	thread->fn = fn;
+	thread->arg = arg;
+#ifdef PCF_IS_WIN
+	thread->handle = (HANDLE)_beginthreadex(NULL, 0, threadEntry, thread, 0, NULL);
+	if (thread->handle == 0) {
+		free(thread);
+		return NULL;
+	}
+#else /* not PCF_IS_WIN */
+	if (pthread_create(&(thread->handle), NULL, threadEntry, thread) != 0) {
+		free(thread);
+		return NULL;
+	}
+#endif /* not PCF_IS_WIN */
+	return thread;
+}
+
+
+/**
+ * Waits for the given thread to finish and deletes its handle.
+ *
+ * @param[in,out] thread - thread handle
+ */
+void thread_join(tThread * thread) {
+	if (thread == NULL) return;
+#ifdef PCF_IS_WIN
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else /* not PCF_IS_WIN */
+	pthread_join(thread->handle, NULL);
+#endif /* not PCF_IS_WIN */
+	free(thread);
+}
+
+
+/**
+ * Gives up the remaining time slice of the calling thread.
+ */
+void thread_yield(void) {
+#ifdef PCF_IS_WIN
+	SwitchToThread();
+#else /* not PCF_IS_WIN */
+	sched_yield();
+#endif /* not PCF_IS_WIN */
+}
+
+
+/**
+ * Returns the number of online processors.
+ *
+ * @return number of processors (at least 1)
+ */
+unsigned int thread_cpuCount(void) {
+#ifdef PCF_IS_WIN
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0) ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else /* not PCF_IS_WIN */
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (unsigned int)count : 1;
+#endif /* not PCF_IS_WIN */
+}
+
+
+/**
+ * Returns the identifier of the calling process.
+ *
+ * @return process identifier
+ */
+unsigned long thread_processId(void) {
+#ifdef PCF_IS_WIN
+	return (unsigned long)GetCurrentProcessId();
+#else /* not PCF_IS_WIN */
+	return (unsigned long)getpid();
+#endif /* not PCF_IS_WIN */
+}
+
+
+/**
+ * Creates a new counting semaphore.
+ *
+ * @param[in] count - initial value
+ * @return semaphore handle or NULL on error
+ */
+tSemaphore * semaphore_create(const unsigned int count) {
+	tSemaphore * sem = (tSemaphore *)malloc(sizeof(tSemaphore));
+	if (sem == NULL) return NULL;
+#ifdef PCF_IS_WIN
+	sem->handle = CreateSemaphore(NULL, (LONG)count, LONG_MAX, NULL);
+	if (sem->handle == NULL) {
+		free(sem);
+		return NULL;
+	}
+#else /* not PCF_IS_WIN */
+	if (pthread_mutex_init(&(sem->mutex), NULL) != 0) {
+		free(sem);
+		return NULL;
+	}
+	if (pthread_cond_init(&(sem->cond), NULL) != 0) {
+		pthread_mutex_destroy(&(sem->mutex));
+		free(sem);
+		return NULL;
+	}
+	sem->count = count;
+#endif /* not PCF_IS_WIN */
+	return sem;
+}
+
+
+/**
+ * Deletes the given semaphore. No thread may wait on it.
+ *
+ * @param[in,out] sem - semaphore handle
+ */
+void semaphore_delete(tSemaphore * sem) {
+	if (sem == NULL) return;
+#ifdef PCF_IS_WIN
+	CloseHandle(sem->handle);
+#else /* not PCF_IS_WIN */
+	pthread_cond_destroy(&(sem->cond));
+	pthread_mutex_destroy(&(sem->mutex));
+#endif /* not PCF_IS_WIN */
+	free(sem);
+}
+
+
+/**
+ * Decrements the given semaphore. This blocks while its value is zero.
+ *
+ * @param[in,out] sem - semaphore handle
+ */
+void semaphore_wait(tSemaphore * sem) {
+#ifdef PCF_IS_WIN
+	WaitForSingleObject(sem->handle, INFINITE);
+#else /* not PCF_IS_WIN */
+	pthread_mutex_lock(&(sem->mutex));
+	while (sem->count == 0) {
+		pthread_cond_wait(&(sem->cond), &(sem->mutex));
+	}
+	sem->count--;
+	pthread_mutex_unlock(&(sem->mutex));
+#endif /* not PCF_IS_WIN */
+}
+
+
+/**
+ * Increments the given semaphore and wakes up a waiting thread.
+ *
+ * @param[in,out] sem - semaphore handle
+ */
+void semaphore_post(tSemaphore * sem) {
+#ifdef PCF_IS_WIN
+	ReleaseSemaphore(sem->handle, 1, NULL);
+#else /* not PCF_IS_WIN */
+	pthread_mutex_lock(&(sem->mutex));
+	sem->count++;
+	pthread_cond_signal(&(sem->cond));
+	pthread_mutex_unlock(&(sem->mutex));
+#endif /* not PCF_IS_WIN */
+}
+
+
+/**
+ * Creates a new ring buffer.
+ *
+ * @param[in] capacity - minimum number of items (rounded up to a power of two; 0 for default)
+ * @param[in] itemSize - size of a single item in bytes
+ * @return created ring buffer or NULL on allocation error
+ */
+tRing * ring_create(const size_t capacity, const size_t itemSize) {
+	size_t n = 2;
+	if (itemSize < 1) return NULL;
+	while (n < ((capacity > 0) ? capacity : (size_t)RING_CAPACITY)) n <<= 1;
+	tRing * ring = (tRing *)malloc(sizeof(tRing));
+	if (ring == NULL) return NULL;
+	memset(ring, 0, sizeof(tRing));
+	ring->data = (unsigned char *)malloc(n * itemSize);
+	if (ring->data == NULL) {
+		free(ring);
+		return NULL;
+	}
+	ring->notFull = semaphore_create(0);
+	ring->notEmpty = semaphore_create(0);
+	if (ring->notFull == NULL || ring->notEmpty == NULL) {
+		ring_delete(ring);
+		return NULL;
+	}
+	ring->mask = n - 1;
+	ring->wakeMask = PCF_MIN((size_t)RING_WAKE_COUNT, n) - 1;
+	ring->itemSize = itemSize;
+	return ring;
+}
+
+
+/**
+ * Deletes the given ring buffer.
+ *
+ * @param[in,out] ring - ring buffer to delete
+ */
+void ring_delete(tRing * ring) {
+	if (ring == NULL) return;
+	semaphore_delete(ring->notFull);
+	semaphore_delete(ring->notEmpty);
+	if (ring->data != NULL) free(ring->data);
+	free(ring);
+}
+
+
+/**
+ * Wakes up the other side of a ring buffer if it announced to wait.
+ *
+ * @param[in,out] waiting - wait flag of the other side
+ * @param[in,out] sem - semaphore the other side waits on
+ */
+static void ringWake(volatile long * waiting, tSemaphore * sem) {
+	/* orders the preceding index update before reading the flag (see ringWait()) */
+	ATOMIC_FENCE();
+	if (ATOMIC_LOAD(*waiting) != 0 && ATOMIC_EXCHANGE(*waiting, 0) != 0) {
+		semaphore_post(sem);
+	}
+}
+
+
+/**
+ * Blocks on the given semaphore unless the ring buffer became ready in the
+ * meantime. The wait is announced before checking again, so either this
+ * check sees the update of the other side or the other side sees the
+ * announcement and posts the semaphore.
+ *
+ * @param[in] ring - ring buffer
+ * @param[in,out] waiting - own wait flag
+ * @param[in,out] sem - semaphore to wait on
+ * @param[in] isReady - returns 1 if the blocked call may continue
+ * @param[in] index - own index passed to isReady
+ */
+static void ringWait(tRing * ring, volatile long * waiting, tSemaphore * sem, int (* isReady)(tRing *, const size_t), const size_t index) {
+	ATOMIC_EXCHANGE(*waiting, 1);
+	if (isReady(ring, index) == 0) {
+		semaphore_wait(sem);
+	} else if (ATOMIC_EXCHANGE(*waiting, 0) == 0) {
+		/* the other side already took the announcement; consume its post */
+		semaphore_wait(sem);
+	}
+}
+
+
+/**
+ * Checks whether the producer may push another item.
+ *
+ * @param[in] ring - ring buffer
+ * @param[in] tail - tail index of the producer
+ * @return 1 if not full, else 0
+ */
+static int ringCanPush(tRing * ring, const size_t tail) {
+	return ((tail - ATOMIC_LOAD(ring->head)) <= ring->mask) ? 1 : 0;
+}
+
+
+/**
+ * Checks whether the consumer may continue, i.e. an item is available or
+ * the ring buffer was closed.
+ *
+ * @param[in] ring - ring buffer
+ * @param[in] head - head index of the consumer
+ * @return 1 if not empty or closed, else 0
+ */
+static int ringCanPop(tRing * ring, const size_t head) {
+	return (ATOMIC_LOAD(ring->tail) != head || ATOMIC_LOAD(ring->closed) != 0) ? 1 : 0;
+}
+
+
+/**
+ * Adds the given item to the ring buffer. This blocks while the ring buffer
+ * is full. Only called by the producer.
+ *
+ * @param[in,out] ring - ring buffer
+ * @param[in] item - item to copy into the ring buffer
+ */
+void ring_push(tRing * ring, const void * item) {
+	const size_t tail = ring->tail; /* only written by this thread */
+	for (size_t n = 0; ringCanPush(ring, tail) == 0; n++) {
+		if (n >= (RING_SPIN_COUNT + RING_YIELD_COUNT)) {
+			ringWait(ring, &(ring->pushWaiting), ring->notFull, ringCanPush, tail);
+		} else if (n >= RING_SPIN_COUNT) {
+			thread_yield();
+		}
+	}
+	memcpy(ring->data + ((tail & ring->mask) * ring->itemSize), item, ring->itemSize);
+	ATOMIC_STORE(ring->tail, tail + 1);
+	/* A waiting consumer is woken up in batches. The consumer only waits on an
+	 * empty ring buffer. Hence, the producer passes a batch boundary before the
+	 * ring buffer gets full. */
+	if (((tail + 1) & ring->wakeMask) == 0) ringWake(&(ring->popWaiting), ring->notEmpty);
+}
+
+
+/**
+ * Removes the next item from the ring buffer. This blocks while the ring
+ * buffer is empty and not closed. Only called by the consumer.
+ *
+ * @param[in,out] ring - ring buffer
+ * @param[out] item - receives a copy of the removed item
+ * @return 1 on success, 0 if the ring buffer is closed and empty
+ */
+int ring_pop(tRing * ring, void * item) {
+	const size_t head = ring->head; /* only written by this thread */
+	for (size_t n = 0; ATOMIC_LOAD(ring->tail) == head; n++) {
+		if (ATOMIC_LOAD(ring->closed) != 0) {
+			/* check again as items may have been added before closing */
+			if (ATOMIC_LOAD(ring->tail) == head) return 0;
+			break;
+		}
+		if (n >= (RING_SPIN_COUNT + RING_YIELD_COUNT)) {
+			ringWait(ring, &(ring->popWaiting), ring->notEmpty, ringCanPop, head);
+		} else if (n >= RING_SPIN_COUNT) {
+			thread_yield();
+		}
+	}
+	memcpy(item, ring->data + ((head & ring->mask) * ring->itemSize), ring->itemSize);
+	ATOMIC_STORE(ring->head, head + 1);
+	/* a waiting producer is woken up in batches (see ring_push()) */
+	if (((head + 1) & ring->wakeMask) == 0) ringWake(&(ring->pushWaiting), ring->notFull);
+	return 1;
+}
+
+
+/**
+ * Marks the end of the items. The consumer receives all remaining items
+ * before ring_pop() returns 0. Only called by the producer.
+ *
+ * @param[in,out] ring - ring buffer
+ */
+void ring_close(tRing * ring) {
+	if (ring == NULL) return;
+	ATOMIC_STORE(ring->closed, 1);
+	ringWake(&(ring->popWaiting), ring->notEmpty);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file thread.h
+ * @author Daniel Starke
+ * @see thread.c
+ * @date 2026-10-18
+ * @version 2026-10-18
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Default number of items of a ring buffer. */
+#define RING_CAPACITY 4096
+
+/** Assumed cache line size in bytes. Used to separate the producer and consumer indices. */
+#define RING_CACHE_LINE 64
+
+
+/** Thread function type. */
+typedef void (* tThreadFn)(void * arg);
+
+
+/** Opaque thread handle. */
+typedef struct tThread tThread;
+
+
+/** Opaque counting semaphore handle. */
+typedef struct tSemaphore tSemaphore;
+
+
+/**
+ * Defines a bounded lock-free single producer/single consumer queue. Only one
+ * thread may push and only one other thread may pop items. Each side only
+ * writes its own index. Blocked calls spin and yield shortly and wait on a
+ * semaphore afterwards, which the other side only posts if a wait was
+ * announced.
+ */
+typedef struct {
+	volatile size_t head;                              /**< Next item to pop (written by the consumer). */
+	char pad0[RING_CACHE_LINE - sizeof(size_t)];       /**< Keeps head and tail in different cache lines. */
+	volatile size_t tail;                              /**< Next item to push (written by the producer). */
+	char pad1[RING_CACHE_LINE - sizeof(size_t)];       /**< Keeps tail and the constant fields in different cache lines. */
+	volatile int closed;                               /**< Set to 1 by the producer if no more items follow. */
+	volatile long pushWaiting;                         /**< Set to 1 by the producer if it waits for a free slot. */
+	volatile long popWaiting;                          /**< Set to 1 by the consumer if it waits for an item. */
+	tSemaphore * notFull;                              /**< Posted by the consumer to wake up the producer. */
+	tSemaphore * notEmpty;                             /**< Posted by the producer to wake up the consumer. */
+	size_t mask;                                       /**< Capacity minus one (capacity is a power of two). */
+	size_t wakeMask;                                   /**< Wake-up batch size minus one (power of two up to the capacity). */
+	size_t itemSize;                                   /**< Size of a single item in bytes. */
+	unsigned char * data;                              /**< Item storage. */
+} tRing;
+
+
+tThread * thread_create(tThreadFn fn, void * arg);
+void thread_join(tThread * thread);
+void thread_yield(void);
+unsigned int thread_cpuCount(void);
+unsigned long thread_processId(void);
+tSemaphore * semaphore_create(const unsigned int count);
+void semaphore_delete(tSemaphore * sem);
+void semaphore_wait(tSemaphore * sem);
+void semaphore_post(tSemaphore * sem);
+tRing * ring_create(const size_t capacity, const size_t itemSize);
+void ring_delete(tRing * ring);
+void ring_push(tRing * ring, const void * item);
+int ring_pop(tRing * ring, void * item);
+void ring_close(tRing * ring);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __THREAD_H__ */